@@ -35,10 +35,23 @@ include_directories (${MongoDB_INCLUDE_DIRS})
 find_package (Pthread REQUIRED)
 include_directories (${Pthread_INCLUDE_DIRS})
 
+# Configure zlib for MODE Z
+find_package (ZLIB REQUIRED)
+include_directories (${ZLIB_INCLUDE_DIRS})
+
 # Some OSes seem to use external libexecinfo
 find_package (Execinfo REQUIRED)
 include_directories(${Execinfo_INCLUDE_DIRS})
 
+# Optional io_uring transfer engine, falls back at runtime if the 
+# kernel doesn't support it
+option (IO_URING "Build the io_uring transfer engine" OFF)
+if (IO_URING)
+  find_package (Liburing REQUIRED)
+  include_directories (${Liburing_INCLUDE_DIRS})
+  add_definitions (-DEBFTPD_IO_URING)
+endif()
+
 
 if(NOT TARGET version)
 	add_custom_target(version 
@@ -52,5 +65,7 @@ list(APPEND ALL_LIBRARIES
   ${Boost_LIBRARIES}
   ${Execinfo_LIBRARIES}
   ${Pthread_LIBRARIES}
+  ${Liburing_LIBRARIES}
+  ${ZLIB_LIBRARIES}
   rt
 )
@@ -0,0 +1,24 @@
+if(Liburing_INCLUDE_DIR AND Liburing_LIBRARY)
+  set(Liburing_INCLUDE_DIRS ${Liburing_INCLUDE_DIR})
+  set(Liburing_LIBRARIES ${Liburing_LIBRARY})
+  set(Liburing_FOUND TRUE)
+  return()
+endif()
+
+find_path(Liburing_INCLUDE_DIR NAMES liburing.h)
+find_library(Liburing_LIBRARY NAMES uring)
+
+if(Liburing_INCLUDE_DIR AND Liburing_LIBRARY)
+  set(Liburing_FOUND TRUE)
+  set(Liburing_INCLUDE_DIRS ${Liburing_INCLUDE_DIR})
+  set(Liburing_LIBRARIES ${Liburing_LIBRARY})
+  message(STATUS "Found Liburing: ${Liburing_INCLUDE_DIRS}, ${Liburing_LIBRARIES}")
+else()
+  if (Liburing_FIND_REQUIRED)
+    message(FATAL_ERROR "Liburing not found.")  
+  else()
+    message(STATUS "Liburing not found.")
+  endif()
+endif()
+
+mark_as_advanced(Liburing_INCLUDE_DIR Liburing_LIBRARY)
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+#
+# Opens a number of control connections to a running ebftpd and reports the
+# connect to banner latency along with the server's resident memory and
+# thread count before, with all connections open and after they've closed.
+#
+# usage: connections.py [options] <host> <port>
+#
+# The server's pid is needed for the memory and thread counts, either with
+# --pid or read from --pidfile. Use enough max_online / max_connections in
+# the config for the count opened, the default is 2000.
+#
+# The memory held per session is the growth in resident memory with all the
+# connections open, divided by the number opened. To compare the footprint of
+# two builds, run each with the same config and --login so every session has
+# picked up its config and user, e.g.
+#
+#   connections.py --login bench:bench --pidfile ebftpd.pid localhost 21
+#
+# Per-thread state such as config copies grows with the size of the config.
+# A config with many sections and rights shows the difference most.
+
+import argparse
+import resource
+import socket
+import sys
+import threading
+import time
+
+
+def proc_status(pid):
+    status = {}
+    if not pid:
+        return status
+    with open("/proc/%d/status" % pid) as f:
+        for line in f:
+            key, _, value = line.partition(":")
+            status[key] = value.strip()
+    return status
+
+
+def report(label, pid):
+    status = proc_status(pid)
+    if not status:
+        return None
+    print("%-12s rss %s, threads %s" % (label, status.get("VmRSS", "?"), 
+                                        status.get("Threads", "?")))
+    return int(status["VmRSS"].split()[0]) if "VmRSS" in status else None
+
+
+def read_reply(sock):
+    # multi line replies end with the line starting "<code> "
+    data = b""
+    while True:
+        chunk = sock.recv(4096)
+        if not chunk:
+            raise EOFError("connection closed")
+        data += chunk
+        lines = data.split(b"\r\n")
+        for line in lines[:-1]:
+            if len(line) >= 4 and line[:3].isdigit() and line[3:4] == b" ":
+                return line
+            
+
+def open_connection(args):
+    start = time.monotonic()
+    sock = socket.create_connection((args.host, args.port), timeout=args.timeout)
+    reply = read_reply(sock)
+    latency = time.monotonic() - start
+    if not reply.startswith(b"220"):
+        raise RuntimeError(reply.decode(errors="replace"))
+    
+    if args.login:
+        user, _, password = args.login.partition(":")
+        sock.sendall(("USER %s\r\n" % user).encode())
+        read_reply(sock)
+        sock.sendall(("PASS %s\r\n" % password).encode())
+        reply = read_reply(sock)
+        if not reply.startswith(b"230"):
+            raise RuntimeError(reply.decode(errors="replace"))
+    return sock, latency
+
+
+def percentile(values, p):
+    return values[min(len(values) - 1, int(len(values) * p / 100.0))]
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("host")
+    parser.add_argument("port", type=int)
+    parser.add_argument("--count", type=int, default=2000)
+    parser.add_argument("--parallel", type=int, default=50,
+                        help="connections opened at the same time")
+    parser.add_argument("--login", metavar="USER:PASS",
+                        help="log each connection in after the banner")
+    parser.add_argument("--pid", type=int)
+    parser.add_argument("--pidfile")
+    parser.add_argument("--timeout", type=float, default=30)
+    parser.add_argument("--settle", type=float, default=5,
+                        help="seconds to wait before taking memory readings")
+    args = parser.parse_args()
+
+    pid = args.pid
+    if not pid and args.pidfile:
+        with open(args.pidfile) as f:
+            pid = int(f.read().strip())
+
+    soft, hard = resource.getrlimit(resource.RLIMIT_NOFILE)
+    if soft < args.count + 64:
+        resource.setrlimit(resource.RLIMIT_NOFILE, (min(hard, args.count + 64), hard))
+
+    rss_before = report("before", pid)
+
+    sockets = []
+    latencies = []
+    errors = []
+    lock = threading.Lock()
+    remaining = [args.count]
+
+    def worker():
+        while True:
+            with lock:
+                if not remaining[0]:
+                    return
+                remaining[0] -= 1
+            try:
+                sock, latency = open_connection(args)
+            except Exception as e:
+                with lock:
+                    errors.append(str(e))
+                continue
+            with lock:
+                sockets.append(sock)
+                latencies.append(latency)
+
+    start = time.monotonic()
+    threads = [threading.Thread(target=worker) for _ in range(args.parallel)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.monotonic() - start
+
+    print("%d connections in %.2fs, %d failed" % (len(sockets), elapsed, len(errors)))
+    for error in sorted(set(errors))[:5]:
+        print("  error: %s" % error)
+
+    if latencies:
+        latencies.sort()
+        print("banner latency ms: min %.1f p50 %.1f p90 %.1f p99 %.1f max %.1f" % (
+              latencies[0] * 1000, percentile(latencies, 50) * 1000,
+              percentile(latencies, 90) * 1000, percentile(latencies, 99) * 1000,
+              latencies[-1] * 1000))
+
+    time.sleep(args.settle)
+    rss_open = report("open", pid)
+    if rss_before is not None and rss_open is not None and sockets:
+        print("%-12s %.1f kB per session" % ("footprint", 
+              (rss_open - rss_before) / float(len(sockets))))
+
+    for sock in sockets:
+        sock.close()
+    time.sleep(args.settle)
+    report("closed", pid)
+
+    return 1 if errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+#
+# Downloads one file from a running ebftpd in RANG segments over several
+# connections at once, checks the segments assemble into the whole file and
+# optionally that they were accounted as a single download.
+#
+# usage: rang.py [options] <host> <port> <user> <password> <path>
+#
+# The assembled file is compared against --local when given, otherwise
+# against a plain RETR of the whole file made after the segments.
+#
+# With --mongo (needs pymongo) the user's credits and download stats are
+# read from the database before and after the segments. The expected
+# result is:
+#   - credits reduced by each segment's kbytes times --ratio
+#   - one file added to the download stats
+#   - the stats kbytes grown by each segment's kbytes
+# Give the user a max_sim_down lower than --segments to check the segments
+# share a single download slot. None of them should then be refused.
+
+import argparse
+import ftplib
+import hashlib
+import sys
+import threading
+
+
+def connect(args):
+    ftp = ftplib.FTP()
+    ftp.connect(args.host, args.port, timeout=args.timeout)
+    ftp.login(args.user, args.password)
+    ftp.voidcmd("TYPE I")
+    return ftp
+
+
+def download_segment(args, start, end, results, index, barrier):
+    ftp = connect(args)
+    try:
+        reply = ftp.sendcmd("RANG %d %d" % (start, end))
+        if not reply.startswith("350"):
+            raise RuntimeError("RANG refused: " + reply)
+
+        # start every RETR together so the segments overlap on the server
+        barrier.wait()
+        chunks = []
+        ftp.retrbinary("RETR " + args.path, chunks.append)
+        results[index] = b"".join(chunks)
+    except Exception as e:
+        results[index] = e
+    finally:
+        try:
+            ftp.quit()
+        except Exception:
+            ftp.close()
+
+
+def check_refused_range(args, size):
+    # a range ending past the end of file must be refused
+    ftp = connect(args)
+    try:
+        ftp.sendcmd("RANG 0 %d" % size)
+        try:
+            ftp.retrbinary("RETR " + args.path, lambda data: None)
+        except ftplib.error_perm:
+            return True
+        return False
+    finally:
+        ftp.quit()
+
+
+def snapshot(args):
+    import pymongo
+    db = pymongo.MongoClient(args.mongo)[args.database]
+    user = db.users.find_one({"name": args.user})
+    if not user:
+        raise RuntimeError("user %s not in database" % args.user)
+
+    credits = 0
+    for entry in user.get("credits", []):
+        if entry["section"] == args.section:
+            credits = entry["value"]
+
+    files = 0
+    kbytes = 0
+    query = {"uid": user["uid"], "direction": "down", "section": ""}
+    for entry in db.transfers.find(query):
+        files += entry.get("files", 0)
+        kbytes += entry.get("kbytes", 0)
+    return credits, files, kbytes
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("host")
+    parser.add_argument("port", type=int)
+    parser.add_argument("user")
+    parser.add_argument("password")
+    parser.add_argument("path")
+    parser.add_argument("--segments", type=int, default=4)
+    parser.add_argument("--local", help="local copy of the file to compare against")
+    parser.add_argument("--timeout", type=float, default=60)
+    parser.add_argument("--mongo", metavar="URI", help="check accounting in the database")
+    parser.add_argument("--database", default="ebftpd")
+    parser.add_argument("--section", default="", help="section the file's credits are kept in")
+    parser.add_argument("--ratio", type=int, default=3, help="user's download ratio for the file")
+    args = parser.parse_args()
+
+    ftp = connect(args)
+    size = ftp.size(args.path)
+    ftp.quit()
+    if size is None or size < args.segments:
+        print("file too small to split into %d segments" % args.segments)
+        return 1
+
+    before = snapshot(args) if args.mongo else None
+
+    step = size // args.segments
+    ranges = []
+    for i in range(args.segments):
+        start = i * step
+        end = size - 1 if i == args.segments - 1 else start + step - 1
+        ranges.append((start, end))
+
+    results = [None] * args.segments
+    barrier = threading.Barrier(args.segments)
+    threads = [threading.Thread(target=download_segment,
+                                args=(args, start, end, results, i, barrier))
+               for i, (start, end) in enumerate(ranges)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    failed = False
+    for (start, end), result in zip(ranges, results):
+        if isinstance(result, Exception):
+            print("segment %d-%d failed: %s" % (start, end, result))
+            failed = True
+        elif len(result) != end + 1 - start:
+            print("segment %d-%d returned %d bytes" % (start, end, len(result)))
+            failed = True
+    if failed:
+        return 1
+
+    after = snapshot(args) if args.mongo else None
+
+    assembled = hashlib.sha256(b"".join(results)).hexdigest()
+    if args.local:
+        with open(args.local, "rb") as f:
+            expected = hashlib.sha256(f.read()).hexdigest()
+    else:
+        chunks = []
+        ftp = connect(args)
+        ftp.retrbinary("RETR " + args.path, chunks.append)
+        ftp.quit()
+        expected = hashlib.sha256(b"".join(chunks)).hexdigest()
+
+    print("%d segments of %d bytes assembled: %s" % (args.segments, size,
+          "match" if assembled == expected else "MISMATCH"))
+    failed = assembled != expected
+
+    if not check_refused_range(args, size):
+        print("range past the end of file was not refused")
+        failed = True
+
+    if args.mongo:
+        # each segment is charged and recorded in whole kbytes of its own
+        segment_kbytes = sum((end + 1 - start) // 1024 for start, end in ranges)
+        credits = before[0] - after[0]
+        files = after[1] - before[1]
+        kbytes = after[2] - before[2]
+        print("credits charged %d (expected %d), files %d (expected 1), kbytes %d (expected %d)" %
+              (credits, segment_kbytes * args.ratio, files, kbytes, segment_kbytes))
+        if credits != segment_kbytes * args.ratio or files != 1 or kbytes != segment_kbytes:
+            failed = True
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -12,18 +12,14 @@ ACL::ACL(const std::string& s)
 
 bool ACL::Evaluate(const ACLInfo& info) const
 {
-  if (finalResult) return *finalResult;
+  // no result is kept, the same acl is evaluated for every user sharing
+  // the config
   for (const Permission& p : perms)
   {
     boost::tribool result = p.Evaluate(info);
-    if (!boost::indeterminate(result))
-    {
-      finalResult.reset(result);
-      return *finalResult;
-    }
+    if (!boost::indeterminate(result)) return static_cast<bool>(result);
   }
-  finalResult.reset(false);
-  return *finalResult;
+  return false;
 }
 
 void ACL::FromStringArg(const std::string& arg)
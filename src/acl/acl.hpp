@@ -30,7 +30,6 @@ struct ACLInfo
 class ACL
 {
   boost::ptr_vector<Permission> perms;
-  mutable boost::optional<bool> finalResult;
 
   void FromStringArg(const std::string& arg);
   void FromString(const std::string& str);
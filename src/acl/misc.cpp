@@ -230,6 +230,35 @@ CreditLoss(const User& user, const fs::VirtualPath& path)
   return boost::optional<const cfg::Creditloss&>();
 }
 
+boost::optional<const cfg::TransferBuffer&> 
+TransferBuffer(const User& user, const fs::VirtualPath& path)
+{
+  auto info = user.ACLInfo();
+  for (const auto& tb : cfg::Get().TransferBuffer())
+  {
+    if (util::WildcardMatch(tb.Path(), path.ToString()) &&
+        tb.ACL().Evaluate(info))
+    {
+      return boost::optional<const cfg::TransferBuffer&>(tb);
+    }
+  }
+  return boost::optional<const cfg::TransferBuffer&>();
+}
+
+int SocketBuffer(const User& user)
+{
+  // data sockets are set up before the transfer path is known, so the
+  // largest socket buffer of any transfer_buffer the user matches is used
+  auto info = user.ACLInfo();
+  int size = 0;
+  for (const auto& tb : cfg::Get().TransferBuffer())
+  {
+    if (tb.SocketBuffer() > size && tb.ACL().Evaluate(info))
+      size = static_cast<int>(tb.SocketBuffer());
+  }
+  return size;
+}
+
 bool SecureIP(const User& user, const std::string& ip, IPStrength& minimum)
 {
   auto info = user.ACLInfo();
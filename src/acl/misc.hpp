@@ -10,6 +10,7 @@ namespace cfg
 class SpeedLimit;
 class Creditcheck;
 class Creditloss;
+class TransferBuffer;
 }
 
 namespace fs
@@ -71,6 +72,11 @@ CreditCheck(const User& user, const fs::VirtualPath& path);
 boost::optional<const cfg::Creditloss&> 
 CreditLoss(const User& user, const fs::VirtualPath& path);
 
+boost::optional<const cfg::TransferBuffer&> 
+TransferBuffer(const User& user, const fs::VirtualPath& path);
+
+int SocketBuffer(const User& user);
+
 class IPStrength;
 bool SecureIP(const User& user, const std::string& ip, IPStrength& minimum);
 
@@ -1,4 +1,3 @@
-#include <boost/algorithm/string/replace.hpp>
 #include <boost/regex.hpp>
 #include "acl/path.hpp"
 #include "fs/owner.hpp"
@@ -33,39 +32,11 @@ bool HiddenFile(const fs::VirtualPath& path)
   return false;
 }
 
-bool Evaluate(const std::vector<cfg::Right>& rights, 
+bool Evaluate(const cfg::Rights& rights, 
               const User& user, const fs::VirtualPath& path)
 {
-  std::string group;
-  bool firstSpecial = true;
-  auto info = user.ACLInfo();
-
-  for (const auto& right : rights)
-  {
-    if (right.SpecialVar())
-    {
-      std::string specialPath(right.Path());
-      boost::replace_all(specialPath, "[:username:]", user.Name());
-      if (firstSpecial)
-      {
-        if (user.PrimaryGID() != -1)
-        {
-          group = user.PrimaryGroup();
-        }
-        firstSpecial = false;
-      }
-      
-      if (!group.empty())
-        boost::replace_all(specialPath, "[:groupname:]", group);
-        
-      if (util::WildcardMatch(specialPath, path.ToString()))
-        return right.ACL().Evaluate(info);
-    }
-    else
-      if (util::WildcardMatch(right.Path(), path.ToString()))
-        return right.ACL().Evaluate(info);
-  }
-  return false;
+  const cfg::Right* right = rights.Match(path.ToString(), user);
+  return right && right->ACL().Evaluate(user.ACLInfo());
 }
 
 template <Type type>
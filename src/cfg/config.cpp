@@ -30,6 +30,13 @@ template <> const char* util::EnumStrings<cfg::LogAddresses>::values[] =
   ""
 };
 
+template <> const char* util::EnumStrings<cfg::SessionModel>::values[] = 
+{
+  "thread",
+  "reactor",
+  ""
+};
+
 }
 
 namespace cfg
@@ -54,6 +61,10 @@ Config::Config(const std::string& configPath, bool tool) :
   version(++latestVersion),
   tool(tool),
   currentSection(nullptr),
+  tlsKernelOffload(true),
+  tlsSessionCacheSize(20480),
+  tlsSessionTimeout(300),
+  tlsTicketRotation(3600),
   port(-1),
   freeSpace(ParseSize("1G")),
   sitenameLong("EBFTPD"),
@@ -68,6 +79,8 @@ Config::Config(const std::string& configPath, bool tool) :
   siteopLog("siteop", true, true, 0),
   transferLog("transfer", false, false, 0, false, false),
   dlIncomplete(true),
+  readAhead(2),
+  compressionLevel(6),
   totalUsers(-1),
   multiplierMax(10),
   emptyNuke(102400),
@@ -79,9 +92,17 @@ Config::Config(const std::string& configPath, bool tool) :
   asyncCRC(false),
   identLookup(true),
   dnsLookup(true),
+  lookupTimeout(15),
   logAddresses(cfg::LogAddresses::Always),
   umask(fs::CurrentUmask()),
   defaultLogLines(100),
+  sessionModel(::cfg::SessionModel::Thread),
+  reactorThreads(2),
+  reactorWorkers(64),
+  sessionThreads(16),
+  sessionStackSize(512),
+  acceptThreads(1),
+  pasvListenerPool(0),
   tlsControl("*"),
   tlsListing("*"),
   tlsData("!*"),
@@ -177,6 +198,24 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
     ParameterCheck(opt, toks, 1);
     tlsCiphers = toks[0];
   }
+  else if (opt == "tls_kernel_offload")
+  {
+    ParameterCheck(opt, toks, 1);
+    tlsKernelOffload = YesNoToBoolean(toks[0]);
+  }
+  else if (opt == "tls_session_cache")
+  {
+    ParameterCheck(opt, toks, 2);
+    tlsSessionCacheSize = boost::lexical_cast<int>(toks[0]);
+    tlsSessionTimeout = boost::lexical_cast<int>(toks[1]);
+    if (tlsSessionCacheSize < 0 || tlsSessionTimeout < 1) throw boost::bad_lexical_cast();
+  }
+  else if (opt == "tls_session_tickets")
+  {
+    ParameterCheck(opt, toks, 1);
+    tlsTicketRotation = boost::lexical_cast<int>(toks[0]);
+    if (tlsTicketRotation < 0) throw boost::bad_lexical_cast();
+  }
   else if (opt == "datapath")
   {
     ParameterCheck(opt, toks, 1);
@@ -228,6 +267,23 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
     ParameterCheck(opt, toks, 1);
     dlIncomplete = YesNoToBoolean(toks[0]);
   }
+  else if (opt == "read_ahead")
+  {
+    ParameterCheck(opt, toks, 1);
+    readAhead = boost::lexical_cast<int>(toks[0]);
+    if (readAhead < 0 || readAhead > 16) throw boost::bad_lexical_cast();
+  }
+  else if (opt == "compression_level")
+  {
+    ParameterCheck(opt, toks, 1);
+    compressionLevel = boost::lexical_cast<int>(toks[0]);
+    if (compressionLevel < 0 || compressionLevel > 9) throw boost::bad_lexical_cast();
+  }
+  else if (opt == "compression_exclude")
+  {
+    ParameterCheck(opt, toks, 1, -1);
+    compressionExclude.insert(compressionExclude.end(), toks.begin(), toks.end());
+  }
   else if (opt == "sitename_long")
   {
     ParameterCheck(opt, toks, 1);
@@ -339,6 +395,11 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
     ParameterCheck(opt, toks, 4, -1);
     minimumSpeed.emplace_back(toks);
   }
+  else if (opt == "transfer_buffer")
+  {
+    ParameterCheck(opt, toks, 4, -1);
+    transferBuffer.emplace_back(toks);
+  }
   else if (opt == "sim_xfers")
   {
     ParameterCheck(opt, toks, 2);
@@ -655,6 +716,17 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
     ParameterCheck(opt, toks, 1);
     dnsLookup = YesNoToBoolean(toks[0]);
   }
+  else if (opt == "lookup_timeout")
+  {
+    ParameterCheck(opt, toks, 1);
+    lookupTimeout = boost::lexical_cast<int>(toks[0]);
+    if (lookupTimeout < 1 || lookupTimeout > 60) throw boost::bad_lexical_cast();
+  }
+  else if (opt == "address_cache")
+  {
+    ParameterCheck(opt, toks, 3);
+    addressCache = ::cfg::AddressCache(toks);
+  }
   else if (opt == "log_addresses")
   {
     ParameterCheck(opt, toks, 1);
@@ -679,6 +751,44 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
     defaultLogLines = boost::lexical_cast<int>(toks[0]);
     if (defaultLogLines < 0) throw boost::bad_lexical_cast();
   }
+  else if (opt == "session_model")
+  {
+    ParameterCheck(opt, toks, 1);
+    if (!util::EnumFromString(toks[0], sessionModel))
+      throw ConfigError("session_model must be either thread or reactor");
+  }
+  else if (opt == "reactor_threads")
+  {
+    ParameterCheck(opt, toks, 2);
+    reactorThreads = boost::lexical_cast<int>(toks[0]);
+    reactorWorkers = boost::lexical_cast<int>(toks[1]);
+    if (reactorThreads < 1 || reactorWorkers < 1) throw boost::bad_lexical_cast();
+  }
+  else if (opt == "session_threads")
+  {
+    ParameterCheck(opt, toks, 2);
+    sessionThreads = boost::lexical_cast<int>(toks[0]);
+    sessionStackSize = boost::lexical_cast<int>(toks[1]);
+    if (sessionThreads < 0 || (sessionStackSize != 0 && sessionStackSize < 128))
+      throw boost::bad_lexical_cast();
+  }
+  else if (opt == "pasv_listener_pool")
+  {
+    ParameterCheck(opt, toks, 1);
+    pasvListenerPool = boost::lexical_cast<int>(toks[0]);
+    if (pasvListenerPool < 0 || pasvListenerPool > 256) throw boost::bad_lexical_cast();
+  }
+  else if (opt == "connection_limit")
+  {
+    ParameterCheck(opt, toks, 3);
+    connectionLimit.emplace_back(toks);
+  }
+  else if (opt == "accept_threads")
+  {
+    ParameterCheck(opt, toks, 1);
+    acceptThreads = boost::lexical_cast<int>(toks[0]);
+    if (acceptThreads < 1) throw boost::bad_lexical_cast();
+  }
   else if (opt == "tls_control")
   {
     tlsControl = acl::ACL(util::Join(toks, " "));
@@ -719,6 +829,20 @@ void Config::ParseSection(const std::string& opt, std::vector<std::string>& toks
     currentSection->ratio = boost::lexical_cast<int>(toks[0]);
     if (currentSection->ratio < 0) throw boost::bad_lexical_cast();
   }
+  else if (opt == "read_ahead")
+  {
+    ParameterCheck(opt, toks, 1);
+    currentSection->readAhead = boost::lexical_cast<int>(toks[0]);
+    if (currentSection->readAhead < -1 || currentSection->readAhead > 16) 
+      throw boost::bad_lexical_cast();
+  }
+  else if (opt == "compression_level")
+  {
+    ParameterCheck(opt, toks, 1);
+    currentSection->compressionLevel = boost::lexical_cast<int>(toks[0]);
+    if (currentSection->compressionLevel < -1 || currentSection->compressionLevel > 9) 
+      throw boost::bad_lexical_cast();
+  }
   else if (opt == "endsection")
   {
     currentSection = nullptr;
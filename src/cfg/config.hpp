@@ -20,6 +20,7 @@ namespace cfg
 enum class WeekStart { Sunday, Monday };
 enum class EPSVFxp { Allow, Deny, Force };
 enum class LogAddresses { Never, Errors, Always };
+enum class SessionModel { Thread, Reactor };
 
 class Config;
 
@@ -46,6 +47,10 @@ class Config
   std::string pidfile;
   std::string tlsCertificate;
   std::string tlsCiphers;
+  bool tlsKernelOffload;
+  int tlsSessionCacheSize;
+  int tlsSessionTimeout;
+  int tlsTicketRotation;
   int port;
   // glftpd
   ::cfg::AsciiDownloads asciiDownloads;
@@ -62,8 +67,11 @@ class Config
   bool bouncerOnly;
   std::vector<SpeedLimit> maximumSpeed;
   std::vector<SpeedLimit> minimumSpeed;
+  std::vector< ::cfg::TransferBuffer> transferBuffer;
+  std::vector<ConnectionLimit> connectionLimit;
   ::cfg::SimXfers simXfers;
   std::vector<std::string> calcCrc;
+  std::vector<std::string> compressionExclude;
   std::vector<std::string> xdupe;
   std::vector<std::string> validIp;
   std::vector<std::string> activeAddr;
@@ -86,27 +94,27 @@ class Config
   ::cfg::TransferLog transferLog;
   
   // ind rights
-  std::vector< ::cfg::Right> delete_; // delete is reserved
-  std::vector< ::cfg::Right> deleteown;
-  std::vector< ::cfg::Right> overwrite;
-  std::vector< ::cfg::Right> overwriteown;
-  std::vector< ::cfg::Right> resume;
-  std::vector< ::cfg::Right> resumeown;
-  std::vector< ::cfg::Right> rename;
-  std::vector< ::cfg::Right> renameown;
-  std::vector< ::cfg::Right> filemove;
-  std::vector< ::cfg::Right> filemoveown;
-  std::vector< ::cfg::Right> makedir;
-  std::vector< ::cfg::Right> upload;
-  std::vector< ::cfg::Right> download;
-  std::vector< ::cfg::Right> downloadown;
-  std::vector< ::cfg::Right> nuke;
-  std::vector< ::cfg::Right> hideinwho;
-  std::vector< ::cfg::Right> freefile;
-  std::vector< ::cfg::Right> nostats;
-  std::vector< ::cfg::Right> hideowner;
-  std::vector< ::cfg::Right> modify;
-  std::vector< ::cfg::Right> modifyown;
+  ::cfg::Rights delete_; // delete is reserved
+  ::cfg::Rights deleteown;
+  ::cfg::Rights overwrite;
+  ::cfg::Rights overwriteown;
+  ::cfg::Rights resume;
+  ::cfg::Rights resumeown;
+  ::cfg::Rights rename;
+  ::cfg::Rights renameown;
+  ::cfg::Rights filemove;
+  ::cfg::Rights filemoveown;
+  ::cfg::Rights makedir;
+  ::cfg::Rights upload;
+  ::cfg::Rights download;
+  ::cfg::Rights downloadown;
+  ::cfg::Rights nuke;
+  ::cfg::Rights hideinwho;
+  ::cfg::Rights freefile;
+  ::cfg::Rights nostats;
+  ::cfg::Rights hideowner;
+  ::cfg::Rights modify;
+  ::cfg::Rights modifyown;
 
   std::vector<std::string> eventpath;
   std::vector<std::string> dupepath;
@@ -120,6 +128,8 @@ class Config
   std::vector<std::string> bannedUsers;
   std::vector< ::cfg::Right> showDiz;
   bool dlIncomplete;
+  int readAhead;
+  int compressionLevel;
   std::vector< ::cfg::Cscript> cscript;
   std::vector<std::string> idleCommands;
   int totalUsers;
@@ -149,9 +159,18 @@ class Config
   bool asyncCRC;
   bool identLookup;
   bool dnsLookup;
+  int lookupTimeout;
+  ::cfg::AddressCache addressCache;
   ::cfg::LogAddresses logAddresses;
   mode_t umask;
   int defaultLogLines;
+  ::cfg::SessionModel sessionModel;
+  int reactorThreads;
+  int reactorWorkers;
+  int sessionThreads;
+  int sessionStackSize;
+  int acceptThreads;
+  int pasvListenerPool;
   
   acl::ACL tlsControl;
   acl::ACL tlsListing;
@@ -188,6 +207,10 @@ public:
   const std::string& Pidfile() const { return pidfile; }
   const std::string& TlsCertificate() const { return tlsCertificate; }
   const std::string& TlsCiphers() const { return tlsCiphers; }
+  bool TlsKernelOffload() const { return tlsKernelOffload; }
+  int TlsSessionCacheSize() const { return tlsSessionCacheSize; }
+  int TlsSessionTimeout() const { return tlsSessionTimeout; }
+  int TlsTicketRotation() const { return tlsTicketRotation; }
   int Port() const { return port; }
   const ::cfg::AsciiDownloads& AsciiDownloads() const { return asciiDownloads; } 
   const ::cfg::AsciiUploads& AsciiUploads() const { return asciiUploads; } 
@@ -208,8 +231,11 @@ public:
   bool BouncerOnly() const { return bouncerOnly; }
   const std::vector<SpeedLimit>& MaximumSpeed() const { return maximumSpeed; }
   const std::vector<SpeedLimit>& MinimumSpeed() const { return minimumSpeed; }
+  const std::vector< ::cfg::TransferBuffer>& TransferBuffer() const { return transferBuffer; }
+  const std::vector<ConnectionLimit>& ConnectionLimits() const { return connectionLimit; }
   const ::cfg::SimXfers& SimXfers() const { return simXfers; }
   const std::vector<std::string>& CalcCrc() const { return calcCrc; }
+  const std::vector<std::string>& CompressionExclude() const { return compressionExclude; }
   const std::vector<std::string>& Xdupe() const { return xdupe; }
   const std::vector<std::string>& ValidIp() const { return validIp; }
   const std::vector<std::string>& ActiveAddr() const { return activeAddr; }
@@ -232,27 +258,27 @@ public:
   const ::cfg::TransferLog TransferLog() const { return transferLog; }
 
   // rights section
-  const std::vector< ::cfg::Right>& Delete() const { return delete_; } 
-  const std::vector< ::cfg::Right>& Deleteown() const { return deleteown; } 
-  const std::vector< ::cfg::Right>& Overwrite() const { return overwrite; } 
-  const std::vector< ::cfg::Right>& Overwriteown() const { return overwriteown; } 
-  const std::vector< ::cfg::Right>& Resume() const { return resume; } 
-  const std::vector< ::cfg::Right>& Resumeown() const { return resumeown; } 
-  const std::vector< ::cfg::Right>& Rename() const { return rename; } 
-  const std::vector< ::cfg::Right>& Renameown() const { return renameown; } 
-  const std::vector< ::cfg::Right>& Filemove() const { return filemove; } 
-  const std::vector< ::cfg::Right>& Filemoveown() const { return filemoveown; } 
-  const std::vector< ::cfg::Right>& Makedir() const { return makedir; } 
-  const std::vector< ::cfg::Right>& Upload() const { return upload; } 
-  const std::vector< ::cfg::Right>& Download() const { return download; } 
-  const std::vector< ::cfg::Right>& Downloadown() const { return downloadown; } 
-  const std::vector< ::cfg::Right>& Modify() const { return modify; } 
-  const std::vector< ::cfg::Right>& Modifyown() const { return modifyown; } 
-  const std::vector< ::cfg::Right>& Nuke() const { return nuke; } 
-  const std::vector< ::cfg::Right>& Hideinwho() const { return hideinwho; } 
-  const std::vector< ::cfg::Right>& Freefile() const { return freefile; } 
-  const std::vector< ::cfg::Right>& Nostats() const { return nostats; } 
-  const std::vector< ::cfg::Right>& Hideowner() const { return hideowner; } 
+  const ::cfg::Rights& Delete() const { return delete_; } 
+  const ::cfg::Rights& Deleteown() const { return deleteown; } 
+  const ::cfg::Rights& Overwrite() const { return overwrite; } 
+  const ::cfg::Rights& Overwriteown() const { return overwriteown; } 
+  const ::cfg::Rights& Resume() const { return resume; } 
+  const ::cfg::Rights& Resumeown() const { return resumeown; } 
+  const ::cfg::Rights& Rename() const { return rename; } 
+  const ::cfg::Rights& Renameown() const { return renameown; } 
+  const ::cfg::Rights& Filemove() const { return filemove; } 
+  const ::cfg::Rights& Filemoveown() const { return filemoveown; } 
+  const ::cfg::Rights& Makedir() const { return makedir; } 
+  const ::cfg::Rights& Upload() const { return upload; } 
+  const ::cfg::Rights& Download() const { return download; } 
+  const ::cfg::Rights& Downloadown() const { return downloadown; } 
+  const ::cfg::Rights& Modify() const { return modify; } 
+  const ::cfg::Rights& Modifyown() const { return modifyown; } 
+  const ::cfg::Rights& Nuke() const { return nuke; } 
+  const ::cfg::Rights& Hideinwho() const { return hideinwho; } 
+  const ::cfg::Rights& Freefile() const { return freefile; } 
+  const ::cfg::Rights& Nostats() const { return nostats; } 
+  const ::cfg::Rights& Hideowner() const { return hideowner; } 
 
   bool IsEventLogged(const std::string& path) const;
   bool IsDupeLogged(const std::string& path) const;
@@ -266,6 +292,8 @@ public:
   const std::vector<std::string>& BannedUsers() const { return bannedUsers; }
   const std::vector< ::cfg::Right>& ShowDiz() const { return showDiz; }
   bool DlIncomplete() const { return dlIncomplete; }
+  int ReadAhead() const { return readAhead; }
+  int CompressionLevel() const { return compressionLevel; }
   const std::vector< ::cfg::Cscript>& Cscript() const { return cscript; }
   const std::vector<std::string>& IdleCommands() const { return idleCommands; }
   int TotalUsers() const { return totalUsers; }
@@ -298,9 +326,18 @@ public:
   bool AsyncCRC() const { return asyncCRC; }
   bool IdentLookup() const { return identLookup; }
   bool DNSLookup() const { return dnsLookup; }
+  int LookupTimeout() const { return lookupTimeout; }
+  const ::cfg::AddressCache& AddressCache() const { return addressCache; }
   ::cfg::LogAddresses LogAddresses() const { return logAddresses; }
   mode_t Umask() const { return umask; }
   int DefaultLogLines() const { return defaultLogLines; }
+  ::cfg::SessionModel SessionModel() const { return sessionModel; }
+  int ReactorThreads() const { return reactorThreads; }
+  int ReactorWorkers() const { return reactorWorkers; }
+  int SessionThreads() const { return sessionThreads; }
+  int SessionStackSize() const { return sessionStackSize; }
+  int AcceptThreads() const { return acceptThreads; }
+  int PasvListenerPool() const { return pasvListenerPool; }
 
   const acl::ACL& CommandACL(const std::string& keyword) const
   { return commandACLs.at(keyword); }
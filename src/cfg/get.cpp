@@ -1,6 +1,6 @@
 #include <cassert>
 #include <boost/thread/tss.hpp>
-#include <mutex>
+#include <atomic>
 #include <boost/signals2.hpp>
 #include "cfg/get.hpp"
 #include "logs/logs.hpp"
@@ -13,62 +13,76 @@ namespace cfg
 namespace
 {
 
-boost::thread_specific_ptr<Config> thisThread;
-std::mutex sharedMutex;
-std::shared_ptr<Config> shared;
+// configs are never modified once loaded, each thread holds a reference
+// to the one it last picked up rather than its own copy, and a reload only
+// swaps the shared pointer. a replaced config is freed when the last thread
+// moves off it
+boost::thread_specific_ptr<std::shared_ptr<const Config>> thisThread;
+std::shared_ptr<const Config> shared;
 boost::signals2::signal<void()> updated;
 
 }
 
 void UpdateShared(const std::shared_ptr<Config> newShared)
 {
-  {
-    std::lock_guard<std::mutex> lock(sharedMutex);
-    shared = newShared;
-  }
-  
+  std::atomic_store(&shared, std::shared_ptr<const Config>(newShared));
   updated();
 }
 
 void UpdateLocal()
 {
-  Config* config = thisThread.get();
-  std::lock_guard<std::mutex> lock(sharedMutex);
-  if (config && shared->Version() <= config->Version()) return;
-  thisThread.reset(new Config(*shared));
+  std::shared_ptr<const Config> latest = std::atomic_load(&shared);
+  std::shared_ptr<const Config>* config = thisThread.get();
+  if (!config) thisThread.reset(new std::shared_ptr<const Config>(latest));
+  else if (*config != latest) *config = latest;
 }
 
 const Config& Get()
 {
-  assert(shared.get()); // program must never call Get until a valid config is loaded
-  Config* config = thisThread.get();
+  std::shared_ptr<const Config>* config = thisThread.get();
   if (!config)
   {
     UpdateLocal();
     config = thisThread.get();
     assert(config);
   }
-  return *config;
+  assert(config->get()); // program must never call Get until a valid config is loaded
+  return **config;
 }
 
 void StopStartCheck()
 {
   const Config& old = cfg::Get();
+  std::shared_ptr<const Config> latest = std::atomic_load(&shared);
   std::vector<std::string> settings;
 
-  if (shared->ValidIp() != old.ValidIp()) settings.push_back("valid_ip");
-  if (shared->Port() != old.Port()) settings.push_back("port");
-  if (shared->TlsCertificate() != old.TlsCertificate()) settings.push_back("tls_certificate");
-  if (shared->TlsCiphers() != old.TlsCiphers()) settings.push_back("tls_ciphers");
+  if (latest->ValidIp() != old.ValidIp()) settings.push_back("valid_ip");
+  if (latest->Port() != old.Port()) settings.push_back("port");
+  if (latest->TlsCertificate() != old.TlsCertificate()) settings.push_back("tls_certificate");
+  if (latest->TlsCiphers() != old.TlsCiphers()) settings.push_back("tls_ciphers");
+  if (latest->SessionModel() != old.SessionModel()) settings.push_back("session_model");
+  if (latest->ReactorThreads() != old.ReactorThreads() ||
+      latest->ReactorWorkers() != old.ReactorWorkers())
+  {
+    settings.push_back("reactor_threads");
+  }
+  
+  if (latest->SessionThreads() != old.SessionThreads() ||
+      latest->SessionStackSize() != old.SessionStackSize())
+  {
+    settings.push_back("session_threads");
+  }
+  
+  if (latest->AcceptThreads() != old.AcceptThreads()) settings.push_back("accept_threads");
   
-  if (shared->Database().Address() != old.Database().Address() ||   
-      shared->Database().Port() != old.Database().Port())
+  if (latest->Database().Address() != old.Database().Address() ||   
+      latest->Database().Port() != old.Database().Port())
   {
     settings.push_back("database");
   }
 
-  if (shared->MaxUsers().Users() != old.MaxUsers().Users() ||
-      shared->MaxUsers().ExemptUsers() != old.MaxUsers().ExemptUsers())
+  if (latest->MaxUsers().Users() != old.MaxUsers().Users() ||
+      latest->MaxUsers().ExemptUsers() != old.MaxUsers().ExemptUsers())
   {
     settings.push_back("max_users");
   }
@@ -18,18 +18,24 @@ class Section
   std::vector<std::string> paths;
   bool separateCredits;
   int ratio;
+  int readAhead;
+  int compressionLevel;
 
 public:
   Section(const std::string& name) :
     name(name),
     separateCredits(false),
-    ratio(-1)
+    ratio(-1),
+    readAhead(-1),
+    compressionLevel(-1)
   { }
   
   const std::string& Name() const { return name; }
   bool IsMatch(const std::string& path) const;
   bool SeparateCredits() const { return separateCredits; }
   int Ratio() const { return ratio; }
+  int ReadAhead() const { return readAhead; }
+  int CompressionLevel() const { return compressionLevel; }
   
   friend class Config;
 };
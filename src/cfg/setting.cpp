@@ -7,6 +7,8 @@
 #include "cfg/error.hpp"
 #include "util/string.hpp"
 #include "cfg/util.hpp"
+#include "util/net/ipaddress.hpp"
+#include "acl/user.hpp"
 
 namespace cfg
 {
@@ -111,9 +113,55 @@ SpeedLimit::SpeedLimit(std::vector<std::string> toks) :
   uploads(ParseSize(toks[2]))
 {
   toks.erase(toks.begin(), toks.begin() + 3);
+  aclString = util::Join(toks, " ");
+  acl = acl::ACL(aclString);
+}
+
+TransferBuffer::TransferBuffer(std::vector<std::string> toks) :
+  path(toks[0]),
+  bufferSize(util::ToLowerCopy(toks[1]) == "auto" ? 0 : ParseSize(toks[1]) * 1024),
+  socketBuffer(toks[2] == "0" ? 0 : ParseSize(toks[2]) * 1024)
+{
+  if (bufferSize != 0 && bufferSize < 1024) throw boost::bad_lexical_cast();
+  if (bufferSize > 16 * 1024 * 1024 || socketBuffer > 64 * 1024 * 1024)
+    throw boost::bad_lexical_cast();
+  toks.erase(toks.begin(), toks.begin() + 3);
   acl = acl::ACL(util::Join(toks, " "));
 }
 
+AddressCache::AddressCache(const std::vector<std::string>& toks) :
+  size(boost::lexical_cast<int>(toks[0])),
+  ttl(boost::lexical_cast<int>(toks[1])),
+  negativeTTL(boost::lexical_cast<int>(toks[2]))
+{
+  if (size < 0 || ttl < 0 || negativeTTL < 0) throw boost::bad_lexical_cast();
+}
+
+ConnectionLimit::ConnectionLimit(const std::vector<std::string>& toks) :
+  mask(toks[0]),
+  prefixLen(-1),
+  maxConnections(boost::lexical_cast<int>(toks[1])),
+  perMinute(boost::lexical_cast<int>(toks[2]))
+{
+  if (maxConnections < -1 || perMinute < -1) throw boost::bad_lexical_cast();
+  
+  std::string address = mask;
+  std::string::size_type pos = mask.find('/');
+  if (pos != std::string::npos)
+  {
+    address = mask.substr(0, pos);
+    prefixLen = boost::lexical_cast<int>(mask.substr(pos + 1));
+    if (prefixLen < 0 || prefixLen > 128) throw boost::bad_lexical_cast();
+  }
+  
+  if (address == "*") return;
+  if (!util::net::IPAddress::Valid(address)) throw boost::bad_lexical_cast();
+  
+  util::net::IPAddress ip(address);
+  if (prefixLen > static_cast<int>(ip.Length()) * 8) throw boost::bad_lexical_cast();
+  network = ip.Masked(prefixLen < 0 ? ip.Length() * 8 : prefixLen).ToString();
+}
+
 SimXfers::SimXfers(std::vector<std::string> toks)
 {
   maxDownloads = boost::lexical_cast<int>(toks[0]);
@@ -160,13 +208,139 @@ Alias::Alias(const std::vector<std::string>& toks)
   path = toks[1];
 }
 
-Right::Right(std::vector<std::string> toks)
+Right::Right(std::vector<std::string> toks) :
+  literal(false)
 {
   path = toks[0];
   toks.erase(toks.begin());
   acl = acl::ACL(util::Join(toks, " "));
   specialVar = path.find("[:username:]") != std::string::npos ||
                path.find("[:groupname:]") != std::string::npos;
+  
+  prefix = path.substr(0, path.find_first_of("*?[\\"));
+  literal = !specialVar && prefix.length() == path.length();
+  
+  if (specialVar)
+  {
+    static const std::string username("[:username:]");
+    static const std::string groupname("[:groupname:]");
+    std::string::size_type pos = 0;
+    while (true)
+    {
+      std::string::size_type userPos = path.find(username, pos);
+      std::string::size_type groupPos = path.find(groupname, pos);
+      if (userPos == std::string::npos && groupPos == std::string::npos)
+      {
+        pieces.emplace_back(path.substr(pos), Variable::None);
+        break;
+      }
+      
+      if (userPos < groupPos)
+      {
+        pieces.emplace_back(path.substr(pos, userPos - pos), Variable::Username);
+        pos = userPos + username.length();
+      }
+      else
+      {
+        pieces.emplace_back(path.substr(pos, groupPos - pos), Variable::Groupname);
+        pos = groupPos + groupname.length();
+      }
+    }
+  }
+}
+
+bool Right::Match(const std::string& path, const std::string& username,
+                  const std::string* groupname) const
+{
+  if (path.compare(0, prefix.length(), prefix) != 0) return false;
+  if (literal) return path.length() == prefix.length();
+  if (!specialVar) return util::WildcardMatch(this->path, path);
+  
+  std::string pattern;
+  for (const auto& piece : pieces)
+  {
+    pattern += piece.first;
+    switch (piece.second)
+    {
+      case Variable::None       :
+        break;
+      case Variable::Username   :
+        pattern += username;
+        break;
+      case Variable::Groupname  :
+        pattern += groupname ? *groupname : "[:groupname:]";
+        break;
+    }
+  }
+  
+  return util::WildcardMatch(pattern, path);
+}
+
+void Rights::emplace_back(const std::vector<std::string>& toks)
+{
+  rights.emplace_back(toks);
+  const std::string& prefix = rights.back().Prefix();
+  
+  // a prefix only narrows the top level directory once it includes the
+  // slash that ends it
+  std::string::size_type end = prefix.find('/', 1);
+  if (prefix[0] == '/' && end != std::string::npos)
+    byTopDir[prefix.substr(1, end - 1)].push_back(rights.size() - 1);
+  else
+    anyTopDir.push_back(rights.size() - 1);
+}
+
+bool Rights::Match(size_t index, const std::string& path, const std::string& username,
+                   const std::function<std::string()>& primaryGroup,
+                   bool& groupLoaded, std::string& group) const
+{
+  const Right& right = rights[index];
+  if (right.SpecialVar() && !groupLoaded)
+  {
+    group = primaryGroup();
+    groupLoaded = true;
+  }
+  
+  return right.Match(path, username, group.empty() ? nullptr : &group);
+}
+
+const Right* Rights::Match(const std::string& path, const acl::User& user) const
+{
+  return Match(path, user.Name(), [&user]()
+    {
+      return user.PrimaryGID() != -1 ? user.PrimaryGroup() : std::string();
+    });
+}
+
+const Right* Rights::Match(const std::string& path, const std::string& username,
+                           const std::function<std::string()>& primaryGroup) const
+{
+  static const std::vector<size_t> none;
+  const std::vector<size_t>* topDir = &none;
+  
+  std::string::size_type end = path.find('/', 1);
+  if (!path.empty() && path[0] == '/' && end != std::string::npos)
+  {
+    auto it = byTopDir.find(path.substr(1, end - 1));
+    if (it != byTopDir.end()) topDir = &it->second;
+  }
+  
+  bool groupLoaded = false;
+  std::string group;
+  
+  // both lists are in config order, merged so the first match still wins
+  auto it1 = topDir->begin();
+  auto it2 = anyTopDir.begin();
+  while (it1 != topDir->end() || it2 != anyTopDir.end())
+  {
+    size_t index;
+    if (it2 == anyTopDir.end() || (it1 != topDir->end() && *it1 < *it2)) index = *it1++;
+    else index = *it2++;
+    
+    if (Match(index, path, username, primaryGroup, groupLoaded, group)) return &rights[index];
+  }
+  
+  return nullptr;
 }
 
 PathFilter::PathFilter() :
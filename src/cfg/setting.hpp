@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <functional>
+#include <unordered_map>
 #include <boost/regex_fwd.hpp>
 #include <sys/types.h>
 #include "acl/acl.hpp"
@@ -17,6 +19,11 @@ class seconds;
 }
 }
 
+namespace acl
+{
+class User;
+}
+
 namespace cfg
 {
 
@@ -44,16 +51,60 @@ public:
 
 class Right
 {
+  enum class Variable { None, Username, Groupname };
+
   std::string path;
   // includes wildcards and possibley regex so can't be std::string path;
   acl::ACL acl;
   bool specialVar;
   
+  // split at load so matching needn't search the pattern, the prefix
+  // is the literal part any matching path must start with
+  std::string prefix;
+  bool literal;
+  std::vector<std::pair<std::string, Variable>> pieces;
+  
 public:
   Right(std::vector<std::string> toks);
   const acl::ACL& ACL() const { return acl; }
   const std::string& Path() const { return path; }
   bool SpecialVar() const { return specialVar; }
+  const std::string& Prefix() const { return prefix; }
+  
+  bool Match(const std::string& path, const std::string& username,
+             const std::string* groupname) const;
+  /* groupname is null when the user has no primary group, [:groupname:] */
+  /* is then left in the pattern as is */
+};
+
+// path rights of one type, indexed by the top level directory of their
+// literal prefix so a check only tries the rights that could match
+class Rights
+{
+  std::vector<Right> rights;
+  std::unordered_map<std::string, std::vector<size_t>> byTopDir;
+  std::vector<size_t> anyTopDir;
+  
+  bool Match(size_t index, const std::string& path, const std::string& username,
+             const std::function<std::string()>& primaryGroup,
+             bool& groupLoaded, std::string& group) const;
+  
+public:
+  void emplace_back(const std::vector<std::string>& toks);
+  
+  typedef std::vector<Right>::const_iterator const_iterator;
+  const_iterator begin() const { return rights.begin(); }
+  const_iterator end() const { return rights.end(); }
+  size_t size() const { return rights.size(); }
+  bool empty() const { return rights.empty(); }
+  
+  const Right* Match(const std::string& path, const acl::User& user) const;
+  /* First right in config order matching path, null when none do */
+  
+  const Right* Match(const std::string& path, const std::string& username,
+                     const std::function<std::string()>& primaryGroup) const;
+  /* As above, primaryGroup is only called once a right using a special */
+  /* variable is tried and returns empty when the user has no group */
 };
 
 class ACLInt
@@ -124,6 +175,7 @@ class SpeedLimit
   std::string path;
   long long downloads;
   long long uploads;
+  std::string aclString;
   acl::ACL acl;
   
 public:
@@ -131,9 +183,65 @@ public:
   const std::string& Path() const { return path; }
   long long Uploads() const { return downloads; }
   long long Downloads() const { return uploads; }
+  const std::string& ACLString() const { return aclString; }
   const acl::ACL& ACL() const { return acl; }
 };
 
+class TransferBuffer
+{
+  std::string path;
+  long long bufferSize;
+  long long socketBuffer;
+  acl::ACL acl;
+  
+public:
+  TransferBuffer(std::vector<std::string> toks);
+  const std::string& Path() const { return path; }
+  // bytes, 0 for adaptive
+  long long BufferSize() const { return bufferSize; }
+  // bytes, 0 for system default
+  long long SocketBuffer() const { return socketBuffer; }
+  const acl::ACL& ACL() const { return acl; }
+};
+
+class AddressCache
+{
+  int size;
+  int ttl;
+  int negativeTTL;
+  
+public:
+  AddressCache() : size(4096), ttl(600), negativeTTL(60) { }
+  AddressCache(const std::vector<std::string>& toks);
+  // entries per lookup type, 0 for disabled
+  int Size() const { return size; }
+  // seconds
+  int TTL() const { return ttl; }
+  int NegativeTTL() const { return negativeTTL; }
+};
+
+class ConnectionLimit
+{
+  std::string mask;
+  std::string network;
+  int prefixLen;
+  int maxConnections;
+  int perMinute;
+  
+public:
+  ConnectionLimit(const std::vector<std::string>& toks);
+  const std::string& Mask() const { return mask; }
+  // * matches every address, each counted separately at prefix length
+  bool Wildcard() const { return network.empty(); }
+  // masked network address, all addresses within counted together
+  const std::string& Network() const { return network; }
+  // -1 for the full address length
+  int PrefixLen() const { return prefixLen; }
+  // -1 for unlimited
+  int MaxConnections() const { return maxConnections; }
+  int PerMinute() const { return perMinute; }
+};
+
 class SimXfers
 {
   int maxDownloads;
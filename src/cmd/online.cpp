@@ -14,14 +14,7 @@ std::string CompileWhosOnline(const std::string& id, text::Template& templ)
 {
   std::vector<ftp::OnlineClient> clients;
   
-  {
-    ftp::OnlineReader reader(id);  
-    
-    {
-      ftp::OnlineReaderLock lock(reader);
-      std::copy(reader.begin(), reader.end(), std::back_inserter(clients));
-    }
-  }
+  ftp::OnlineReader(id).Snapshot(clients);
   
   std::ostringstream multiStr;
   for (const auto& client : clients)
@@ -45,6 +45,42 @@ void ABORCommand::Execute()
   return;
 }
 
+void ALLOCommand::Execute()
+{
+  // ALLO <size> [R <record size>], record size is meaningless for us
+  if (args.size() == 3 || (args.size() == 4 && util::ToUpperCopy(args[2]) != "R"))
+    throw cmd::SyntaxError();
+
+  off_t size;
+  try
+  {
+    size = boost::lexical_cast<off_t>(args[1]);
+    if (size < 0) throw boost::bad_lexical_cast();
+  }
+  catch (const boost::bad_lexical_cast&)
+  {
+    control.Reply(ftp::SyntaxError, "Invalid allocation size.");
+    return;
+  }
+  
+  // the reservation mustn't eat into the space kept free, which uploads
+  // themselves are checked against as files are created
+  unsigned long long freeBytes;
+  auto e = util::path::FreeDiskSpace(fs::MakeReal(fs::WorkDirectory()).ToString(), freeBytes);
+  unsigned long long reserved = static_cast<unsigned long long>(cfg::Get().FreeSpace()) * 1024;
+  if (e && (freeBytes < reserved || static_cast<unsigned long long>(size) > freeBytes - reserved))
+  {
+    control.Reply(ftp::NoDiskFree, "Insufficient disk space for allocation.");
+    return;
+  }
+  
+  data.SetAllocateSize(size);
+  
+  std::ostringstream os;
+  os << "Allocation size for next upload set to " << size << ".";
+  control.Reply(ftp::CommandOkay, os.str());
+}
+
 void AUTHCommand::Execute()
 {
   if (!util::net::TLSServerContext::Get())
@@ -248,6 +284,8 @@ void FEATCommand::Execute()
   control.PartReply(ftp::NoCode, " SSCN");
   control.PartReply(ftp::NoCode, " CPSV");
   control.PartReply(ftp::NoCode, " MFMT");
+  control.PartReply(ftp::NoCode, " MODE Z");
+  control.PartReply(ftp::NoCode, " RANG STREAM");
   control.Reply(ftp::SystemStatus, "End.");
 
   (void) singleLineReplies;
@@ -268,11 +306,11 @@ void HELPCommand::Execute()
   static const char* reply =
     " ebftpd Command listing:\n"
     "------------------------------------------------------------------\n"
-    " ABOR *ACCT *ADAT *ALLO  APPE  AUTH *CCC   CDUP *CONF  CWD   DELE\n"
+    " ABOR *ACCT *ADAT  ALLO  APPE  AUTH *CCC   CDUP *CONF  CWD   DELE\n"
     "*ENC   EPRT  EPSV  FEAT  HELP *LANG  LIST *LPRT *LPSV  MDTM *MIC\n"
     " MKD  *MLSD *MLST  MODE  NLST  NOOP *OPTS  PASS  PASV  PBSZ  PORT\n"
-    " PROT  PWD   QUIT *REIN *REST  RETR  RMD   RNFR  RNTO  SITE  SIZE\n"
-    "*SMNT  STAT  STOR  STOU *STRU  SYST  TYPE\n"
+    " PROT  PWD   QUIT  RANG *REIN  REST  RETR  RMD   RNFR  RNTO\n"
+    " SITE  SIZE *SMNT  STAT  STOR  STOU *STRU  SYST  TYPE\n"
     "------------------------------------------------------------------\n"
     "End of list.                         (* Commands not implemented)";
     
@@ -329,6 +367,7 @@ void LISTCommand::Execute()
   try
   {
     dirList.Execute();    
+    data.Finish();
   }
   catch (const util::net::NetworkError& e)
   {
@@ -530,7 +569,15 @@ void MKDCommand::Execute()
 void MODECommand::Execute()
 {
   if (args[1] == "S")
+  {
+    data.SetTransferMode(ftp::TransferMode::Stream);
     control.Reply(ftp::CommandOkay, "Transfer mode set to 'stream'.");
+  }
+  else if (args[1] == "Z")
+  {
+    data.SetTransferMode(ftp::TransferMode::Zlib);
+    control.Reply(ftp::CommandOkay, "Transfer mode set to 'zlib'.");
+  }
   else if (args[1] == "B")
     control.Reply(ftp::ParameterNotImplemented,
                  "Transfer mode 'block' not implemented.");
@@ -673,23 +720,67 @@ void QUITCommand::Execute()
   client.SetState(ftp::ClientState::Finished);
 }
 
+void RANGCommand::Execute()
+{
+  off_t start;
+  off_t end;
+  
+  try
+  {
+    start = boost::lexical_cast<off_t>(args[1]);
+    end = boost::lexical_cast<off_t>(args[2]);
+    if (start < 0 || end < 0) throw boost::bad_lexical_cast();
+  }
+  catch (const boost::bad_lexical_cast&)
+  {
+    control.Reply(ftp::InvalidRESTParameter, "Invalid parameter, byte range reset.");
+    data.SetRestartOffset(0);
+    data.SetRangeEnd(-1);
+    return;
+  }
+  
+  // RANG 1 0 is the reset
+  if (start == 1 && end == 0)
+  {
+    data.SetRestartOffset(0);
+    data.SetRangeEnd(-1);
+    control.Reply(ftp::PendingMoreInfo, "Byte range reset.");
+    return;
+  }
+  
+  if (end < start)
+  {
+    control.Reply(ftp::InvalidRESTParameter, "Invalid parameter, range end before start.");
+    return;
+  }
+  
+  data.SetRestartOffset(start);
+  data.SetRangeEnd(end);
+  
+  std::ostringstream os;
+  os << "Restarting at " << start << ". End byte range at " << end << ".";
+  control.Reply(ftp::PendingMoreInfo, os.str());
+}
+
 void RESTCommand::Execute()
 {
   off_t restart;
   
   try
   {
-    restart = boost::lexical_cast<int>(args[1]);
+    restart = boost::lexical_cast<off_t>(args[1]);
     if (restart < 0) throw boost::bad_lexical_cast();
   }
   catch (const boost::bad_lexical_cast&)
   {
     control.Reply(ftp::InvalidRESTParameter, "Invalid parameter, restart offset set to 0.");
     data.SetRestartOffset(0);
+    data.SetRangeEnd(-1);
     return;
   }
   
   data.SetRestartOffset(restart);
+  data.SetRangeEnd(-1);
   
   std::ostringstream os;
   os << "Restart offset set to " << restart << ".";
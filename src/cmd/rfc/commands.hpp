@@ -15,6 +15,15 @@ public:
   void Execute();
 };
 
+class ALLOCommand : public Command
+{
+public:
+  ALLOCommand(ftp::Client& client, const std::string& argStr, const Args& args) :
+    Command(client, client.Control(), client.Data(), argStr, args) { }
+
+  void Execute();
+};
+
 class AUTHCommand : public Command
 {
 public:
@@ -245,6 +254,15 @@ public:
   void Execute();
 };
 
+class RANGCommand : public Command
+{
+public:
+  RANGCommand(ftp::Client& client, const std::string& argStr, const Args& args) :
+    Command(client, client.Control(), client.Data(), argStr, args) { }
+
+  void Execute();
+};
+
 class RESTCommand : public Command
 {
 public:
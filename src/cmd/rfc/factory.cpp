@@ -20,8 +20,8 @@ Factory::Factory()
                   nullptr, "NOT IMPLEMENTED" }, },
     { "ADAT",   { 0,  -1, ftp::ClientState::AnyState,         ftp::ActionNotOkay,
                   nullptr, "NOT IMPLEMENTED" }, },
-    { "ALLO",   { 0,  -1, ftp::ClientState::AnyState,         ftp::ActionNotOkay,
-                  nullptr, "NOT IMPLEMENTED" }, },
+    { "ALLO",   { 1,  3,  ftp::ClientState::LoggedIn,         ftp::ActionNotOkay,
+                  std::make_shared<Creator<ALLOCommand>>(), "ALLO <size> [R <record size>]" }, },
     { "APPE",   { 0,  -1, ftp::ClientState::AnyState,         ftp::ActionNotOkay,
                   nullptr, "NOT IMPLEMENTED" }, },
     { "AUTH",   { 1,  1,  ftp::ClientState::LoggedOut,        ftp::ActionNotOkay,
@@ -71,7 +71,7 @@ Factory::Factory()
     { "MLST",   { 0,  -1, ftp::ClientState::AnyState,         ftp::ActionNotOkay,
                   nullptr, "NOT IMPLEMENTED" }, },
     { "MODE",   { 1,  1,  ftp::ClientState::LoggedIn,         ftp::ActionNotOkay,
-                  std::make_shared<Creator<MODECommand>>(), "MODE S|B|C" }, },
+                  std::make_shared<Creator<MODECommand>>(), "MODE S|B|C|Z" }, },
     { "NLST",   { 0,  -1, ftp::ClientState::LoggedIn,         ftp::ActionNotOkay,
                   std::make_shared<Creator<NLSTCommand>>(), "NLST [-<options>] [<path>]" }, },
     { "NOOP",   { 0,  0,  ftp::ClientState::AnyState,         ftp::ActionNotOkay,
@@ -94,6 +94,8 @@ Factory::Factory()
                   std::make_shared<Creator<QUITCommand>>(), "QUIT" }, },
     { "REIN",   { 0,  -1, ftp::ClientState::AnyState,         ftp::ActionNotOkay,
                   nullptr, "NOT IMPLEMENTED" }, },
+    { "RANG",   { 2,  2,  ftp::ClientState::LoggedIn,         ftp::ActionNotOkay,
+                  std::make_shared<Creator<RANGCommand>>(), "RANG <start> <end>" }, },
     { "REST",   { 1,  1,  ftp::ClientState::AnyState,         ftp::ActionNotOkay,
                   std::make_shared<Creator<RESTCommand>>(), "REST <offset>" }, },
     { "RETR",   { 1,  1,  ftp::ClientState::LoggedIn,         ftp::ActionNotOkay,
@@ -1,4 +1,6 @@
 #include <ios>
+#include <memory>
+#include <algorithm>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/logic/tribool.hpp>
 #include "cmd/rfc/retr.hpp"
@@ -22,6 +24,11 @@
 #include "stats/types.hpp"
 #include "stats/stat.hpp"
 #include "ftp/online.hpp"
+#include "util/cpuusage.hpp"
+#include "ftp/uringengine.hpp"
+#include "ftp/transferbuffer.hpp"
+#include "ftp/readahead.hpp"
+#include "ftp/compression.hpp"
 
 namespace cmd { namespace rfc
 {
@@ -42,15 +49,24 @@ void RETRCommand::Execute()
   namespace gd = boost::gregorian;
   
   off_t offset = data.RestartOffset();
-  if (offset > 0 && data.DataType() == ftp::DataType::ASCII)
+  off_t rangeEnd = data.RangeEnd();
+  bool ranged = rangeEnd >= 0;
+  if ((offset > 0 || ranged) && data.DataType() == ftp::DataType::ASCII)
   {
     control.Reply(ftp::BadCommandSequence, "Resume not supported on ASCII data type.");
     throw cmd::NoPostScriptError();
   }
   
-  switch(ftp::Counter::Download().Start(client.User().ID(), 
-         client.User().MaxSimDown(), 
-         client.User().HasFlag(acl::Flag::Exempt)))
+  fs::VirtualPath path(fs::PathFromUser(argStr));
+  
+  // each segment of a download split over several connections is a
+  // separate RETR, together they take up one download slot
+  auto countStart = ranged ?
+      ftp::Counter::Download().Start(client.User().ID(), client.User().MaxSimDown(), 
+                                     client.User().HasFlag(acl::Flag::Exempt), path.ToString()) :
+      ftp::Counter::Download().Start(client.User().ID(), client.User().MaxSimDown(), 
+                                     client.User().HasFlag(acl::Flag::Exempt));
+  switch (countStart)
   {
     case ftp::CounterResult::PersonalFail  :
     {
@@ -70,9 +86,11 @@ void RETRCommand::Execute()
       break;
   }
   
-  auto countGuard = util::MakeScopeExit([&]{ ftp::Counter::Download().Stop(client.User().ID()); });  
-  
-  fs::VirtualPath path(fs::PathFromUser(argStr));
+  auto countGuard = util::MakeScopeExit([&]
+  {
+    if (ranged) ftp::Counter::Download().Stop(client.User().ID(), path.ToString());
+    else ftp::Counter::Download().Stop(client.User().ID());
+  });  
 
   fs::FileSourcePtr fin;
   try
@@ -94,6 +112,12 @@ void RETRCommand::Execute()
       control.Reply(ftp::InvalidRESTParameter, "Restart offset larger than file size.");
       throw cmd::NoPostScriptError();
     }
+    
+    if (rangeEnd >= size)
+    {
+      control.Reply(ftp::InvalidRESTParameter, "Range end larger than file size.");
+      throw cmd::NoPostScriptError();
+    }
 
     fin->seek(offset, std::ios_base::beg);
   }
@@ -111,9 +135,15 @@ void RETRCommand::Execute()
     throw cmd::NoPostScriptError();
   }
   
+  // a segment is charged for its own bytes, so the segments of a file add
+  // up to one download of it, and only the one from the start of the file
+  // counts as a file in the stats
+  off_t chargeSize = ranged ? rangeEnd + 1 - offset : size;
+  bool countFile = !ranged || offset == 0;
+  
   int ratio = -1;
   auto section = cfg::Get().SectionMatch(path.ToString());
-  boost::tribool allotment = CheckWeeklyAllotment(client.User(), section ? section->Name() : "", size);
+  boost::tribool allotment = CheckWeeklyAllotment(client.User(), section ? section->Name() : "", chargeSize);
   if (!allotment)
   {
     control.Reply(ftp::ActionNotOkay, "Not enough allotment left to download that file.");
@@ -124,7 +154,7 @@ void RETRCommand::Execute()
   {
     ratio = stats::DownloadRatio(client, path, section);
     if (!client.User().DecrSectionCredits(section && section->SeparateCredits() ? 
-            section->Name() : "", size / 1024 * ratio))
+            section->Name() : "", chargeSize / 1024 * ratio))
     {
       control.Reply(ftp::ActionNotOkay, "Not enough credits to download that file.");
       throw cmd::NoPostScriptError();
@@ -135,14 +165,14 @@ void RETRCommand::Execute()
   os << "Opening " << (data.DataType() == ftp::DataType::ASCII ? "ASCII" : "BINARY") 
      << " connection for download of " 
      << fs::MakePretty(path).ToString()
-     << " (" << size << " bytes)";
+     << " (" << chargeSize << " bytes)";
   if (data.Protection()) os << " using TLS/SSL";
   os << ".";
   control.Reply(ftp::TransferStatusOkay, os.str());
 
   try
   {
-    data.Open(ftp::TransferType::Download);
+    data.Open(ftp::TransferType::Download, ftp::CompressionLevel(path));
   }
   catch (const util::net::NetworkError&e )
   {
@@ -150,30 +180,32 @@ void RETRCommand::Execute()
     throw cmd::NoPostScriptError();
   }
 
+  ftp::TransferBuffer buffer(acl::TransferBuffer(client.User(), path));
+
   auto dataGuard = util::MakeScopeExit([&]
   {
     if (data.State().Type() != ftp::TransferType::None)
     {
       data.Close();
       db::stats::Download(client.User(), data.State().Bytes() / 1024, 
-                          data.State().Duration().total_milliseconds());
+                          data.State().Duration().total_milliseconds(), "", countFile);
     }
     
     if (boost::indeterminate(allotment))
     {
       assert(ratio != -1);
-      if (size > data.State().Bytes())
+      if (chargeSize > data.State().Bytes())
       {
         // download failed short, give the remaining credits back
         client.User().IncrSectionCredits(section && section->SeparateCredits() ? 
-                section->Name() : "", (size - data.State().Bytes()) / 1024 * ratio);
+                section->Name() : "", (chargeSize - data.State().Bytes()) / 1024 * ratio);
       }
       else
-      if (data.State().Bytes() > size)
+      if (data.State().Bytes() > chargeSize)
       {
         // final download size was larger than at start, take some more credits
         client.User().DecrSectionCreditsForce(section && section->SeparateCredits() ? 
-                section->Name() : "", (data.State().Bytes() - size) * ratio);
+                section->Name() : "", (data.State().Bytes() - chargeSize) * ratio);
       }
     }
   });  
@@ -194,46 +226,136 @@ void RETRCommand::Execute()
       logs::Transfer(fs::MakeReal(path).ToString(), "down", client.User().Name(), client.User().PrimaryGroup(), 
                      (data.State().StartTime() - pt::ptime(gd::date(1970, 1, 1))).total_microseconds() / 1000000.0, 
                      data.State().Bytes() / 1024, data.State().Duration().total_microseconds() / 1000000.0, 
-                     okay, section ? section->Name() : std::string());
+                     okay, buffer.Size(), buffer.Adaptive() ? "adaptive" : "fixed",
+                     data.SocketBuffer(), section ? section->Name() : std::string());
       }
   });
   
   bool aborted = false;
+  bool sendFile = data.CanSendFile();
+  const char* method = sendFile ? "sendfile" : 
+                       data.TransferMode() == ftp::TransferMode::Zlib ? "deflate" : "copy";
+  util::CPUUsage cpuUsage;
   try
   {
     ftp::DownloadSpeedControl speedControl(client, path);
-    ftp::OnlineTransferUpdater onlineUpdater(boost::this_thread::get_id(), stats::Direction::Download,
+    ftp::OnlineTransferUpdater onlineUpdater(client.SessionID(), stats::Direction::Download,
                                              data.State().StartTime());
     
     bool dlIncomplete = cfg::Get().DlIncomplete();
-    std::vector<char> asciiBuf;
-    char buffer[16384];
-    
-    while (true)
+    int readAheadDepth = section && section->ReadAhead() >= 0 ? 
+                         section->ReadAhead() : cfg::Get().ReadAhead();
+#if defined(EBFTPD_IO_URING)
+    ftp::UringEngine* engine = sendFile && !ranged ? ftp::UringEngine::Get() : nullptr;
+    if (engine)
     {
-      std::streamsize len = fin->read(buffer, sizeof(buffer));
-      if (len < 0) 
+      method = "io_uring";
+      engine->Download(data, fin->handle(), offset,
+          [&]() { return dlIncomplete && fs::IsIncomplete(MakeReal(path)); },
+          [&](size_t len)
+          {
+            data.State().Update(len);
+            onlineUpdater.Update(data.State().Bytes());
+            speedControl.Apply();
+          });
+    }
+    else
+#endif
+    if (sendFile)
+    {
+      // chunked so speed control, online updates and ABOR are still
+      // handled between each sendfile call
+      off_t fileOffset = offset;
+      off_t advisedOffset = offset;
+      if (readAheadDepth > 0) 
+        ftp::ReadAhead::Sequential(fin->handle(), offset, ranged ? rangeEnd + 1 - offset : 0);
+      
+      while (!ranged || fileOffset <= rangeEnd)
       {
-        if (!dlIncomplete || !fs::IsIncomplete(MakeReal(path))) break;
-        boost::this_thread::sleep(pt::microseconds(10000));
-        continue;
+        // no buffers to fill ahead of sendfile, so ask the kernel to
+        // start reading the upcoming window instead, never past the range
+        off_t window = static_cast<off_t>(buffer.Size()) * readAheadDepth;
+        off_t adviseFrom = std::max(fileOffset, advisedOffset);
+        if (ranged) window = std::min<off_t>(window, rangeEnd + 1 - adviseFrom);
+        if (readAheadDepth > 0 && window > 0 && fileOffset + window > advisedOffset)
+        {
+          ftp::ReadAhead::WillNeed(fin->handle(), adviseFrom, window);
+          advisedOffset = adviseFrom + window;
+        }
+        
+        size_t count = buffer.Size();
+        if (ranged) count = std::min<off_t>(count, rangeEnd + 1 - fileOffset);
+        
+        size_t len = data.SendFile(fin->handle(), fileOffset, count);
+        if (len == 0)
+        {
+          if (!dlIncomplete || !fs::IsIncomplete(MakeReal(path))) break;
+          boost::this_thread::sleep(pt::microseconds(10000));
+          continue;
+        }
+        
+        data.State().Update(len);
+        buffer.Update(len);
+        onlineUpdater.Update(data.State().Bytes());
+        speedControl.Apply();
       }
-      
-      data.State().Update(len);
-      
-      char *bufp = buffer;
-      if (data.DataType() == ftp::DataType::ASCII)
+    }
+    else
+    {
+      std::vector<char> asciiBuf;
+      std::unique_ptr<ftp::ReadAhead> readAhead;
+      if (readAheadDepth > 0)
       {
-        ftp::ASCIITranscodeRETR(buffer, len, asciiBuf);
-        len = asciiBuf.size();
-        bufp = asciiBuf.data();
+        readAhead.reset(new ftp::ReadAhead(fin->handle(), offset, ranged ? rangeEnd + 1 : -1,
+                                           buffer.Size(), readAheadDepth));
       }
+    
+      off_t position = offset;
+      while (!ranged || position <= rangeEnd)
+      {
+        char *bufp;
+        std::streamsize len;
+        if (readAhead)
+        {
+          readAhead->SetChunkSize(buffer.Size());
+          len = readAhead->Next(bufp);
+          if (len == 0) len = -1;
+        }
+        else
+        {
+          bufp = buffer.Data();
+          len = fin->read(bufp, buffer.Size());
+        }
+        
+        if (len < 0) 
+        {
+          if (!dlIncomplete || !fs::IsIncomplete(MakeReal(path))) break;
+          boost::this_thread::sleep(pt::microseconds(10000));
+          continue;
+        }
+        
+        if (ranged) len = std::min<off_t>(len, rangeEnd + 1 - position);
+        position += len;
+      
+        data.State().Update(len);
+        buffer.Update(len);
+      
+        if (data.DataType() == ftp::DataType::ASCII)
+        {
+          ftp::ASCIITranscodeRETR(bufp, len, asciiBuf);
+          len = asciiBuf.size();
+          bufp = asciiBuf.data();
+        }
       
-      data.Write(bufp, len);
+        data.Write(bufp, len);
+        if (readAhead) readAhead->Release();
 
-      onlineUpdater.Update(data.State().Bytes());
-      speedControl.Apply();
+        onlineUpdater.Update(data.State().Bytes());
+        speedControl.Apply();
+      }
     }
+    
+    data.Finish();
   }
   catch (const ftp::TransferAborted&) { aborted = true; }
   catch (const std::ios_base::failure& e)
@@ -266,11 +388,15 @@ void RETRCommand::Execute()
   
   fin->close();
   data.Close();
+  
+  logs::Debug("Download by %1% used %2%s user and %3%s system cpu time for %4% bytes (%5%, %6% byte buffer)",
+              client.User().Name(), cpuUsage.User(), cpuUsage.System(),
+              data.State().Bytes(), method, buffer.Size());
 
   auto duration = data.State().Duration();
   bool nostats = !section || acl::path::FileAllowed<acl::path::Nostats>(client.User(), path);
   db::stats::Download(client.User(), data.State().Bytes() / 1024, duration.total_milliseconds(),
-                      nostats ? "" : section->Name());
+                      nostats ? "" : section->Name(), countFile);
                       
   double speed = stats::CalculateSpeed(data.State().Bytes(), duration);
   
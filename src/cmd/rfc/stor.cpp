@@ -1,5 +1,6 @@
 #include <ios>
 #include <unistd.h>
+#include <fcntl.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include "cmd/rfc/stor.hpp"
 #include "fs/file.hpp"
@@ -26,6 +27,11 @@
 #include "acl/flags.hpp"
 #include "ftp/xdupe.hpp"
 #include "ftp/online.hpp"
+#include "util/cpuusage.hpp"
+#include "util/pipe.hpp"
+#include "ftp/uringengine.hpp"
+#include "ftp/transferbuffer.hpp"
+#include "ftp/writebehind.hpp"
 
 namespace cmd { namespace rfc
 {
@@ -48,6 +54,65 @@ std::string FileAge(const fs::RealPath& path)
   return std::string("");
 }
 
+#if defined(__linux__)
+void SpliceToFile(int pipeFd, int fd, size_t len)
+{
+  while (len > 0)
+  {
+    ssize_t result = splice(pipeFd, nullptr, fd, nullptr, len, 
+                            SPLICE_F_MOVE | SPLICE_F_MORE);
+    if (result < 0)
+    {
+      if (errno == EINTR) continue;
+      throw std::ios_base::failure("splice: " + util::ErrnoToMessage(errno));
+    }
+    len -= result;
+  }
+}
+
+std::unique_ptr<util::Pipe> SplicePipe(int fd)
+{
+  // splice refuses to write to files opened for append, resumed uploads
+  // are already positioned at the end of file
+  int flags = fcntl(fd, F_GETFL);
+  if (flags < 0 || ((flags & O_APPEND) && fcntl(fd, F_SETFL, flags & ~O_APPEND) < 0))
+    return nullptr;
+  
+  try
+  {
+    return std::unique_ptr<util::Pipe>(new util::Pipe());
+  }
+  catch (const util::SystemError& e)
+  {
+    logs::Error("Unable to create pipe for upload, using copy: %1%", e.Message());
+  }
+  
+  return nullptr;
+}
+#endif
+
+// spliced and io_uring uploads never pass through this loop, so the crc
+// is calculated from the file once the transfer completes
+bool CRCFromFile(const fs::RealPath& path, off_t offset, off_t len, util::CRC32& crc32,
+                 char* buffer, size_t bufferSize)
+{
+  int fd = open(path.CString(), O_RDONLY);
+  if (fd < 0) return false;
+  auto fdGuard = util::MakeScopeExit([fd]{ close(fd); });
+  
+  while (len > 0)
+  {
+    ssize_t result = pread(fd, buffer, std::min<off_t>(bufferSize, len), offset);
+    if (result < 0 && errno == EINTR) continue;
+    if (result <= 0) return false;
+    crc32.Update(reinterpret_cast<uint8_t*>(buffer), result);
+    offset += result;
+    len -= result;
+  }
+  
+  return true;
+}
+
 }
 
 void STORCommand::DupeMessage(const fs::VirtualPath& path)
@@ -107,6 +172,12 @@ void STORCommand::Execute()
     throw cmd::NoPostScriptError();
   }
 
+  if (data.RangeEnd() >= 0)
+  {
+    control.Reply(ftp::BadCommandSequence, "Byte ranges only supported on downloads.");
+    throw cmd::NoPostScriptError();
+  }
+  
   off_t offset = data.RestartOffset();
   if (offset > 0 && data.DataType() == ftp::DataType::ASCII)
   {
@@ -215,6 +286,8 @@ void STORCommand::Execute()
     throw cmd::NoPostScriptError();
   }
 
+  ftp::TransferBuffer buffer(acl::TransferBuffer(client.User(), path));
+
   auto dataGuard = util::MakeScopeExit([&]
   {
     if (data.State().Type() != ftp::TransferType::None)
@@ -246,41 +319,87 @@ void STORCommand::Execute()
       logs::Transfer(fs::MakeReal(path).ToString(), "up", client.User().Name(), client.User().PrimaryGroup(), 
                      (data.State().StartTime() - pt::ptime(gd::date(1970, 1, 1))).total_microseconds() / 1000000.0, 
                      data.State().Bytes() / 1024, data.State().Duration().total_microseconds() / 1000000.0,
-                     okay, section ? section->Name() : std::string());
+                     okay, buffer.Size(), buffer.Adaptive() ? "adaptive" : "fixed",
+                     data.SocketBuffer(), section ? section->Name() : std::string());
       }
   });
   
-  static const size_t bufferSize = 16384;
   bool calcCrc = CalcCRC(path);
   std::unique_ptr<util::CRC32> crc32(cfg::Get().AsyncCRC() ? 
-                                     new util::AsyncCRC32(bufferSize, 10) :
+                                     new util::AsyncCRC32(buffer.Size(), 10) :
                                      new util::CRC32());
   bool aborted = false;
   fileOkay = false;
   
+  ftp::WriteBehind writer(fout->handle(), data.AllocateSize());
+  
+  const char* method = data.TransferMode() == ftp::TransferMode::Zlib ? "inflate" : "copy";
+  bool crcFromFile = false;
+  util::CPUUsage cpuUsage;
+  
   try
   {
     ftp::UploadSpeedControl speedControl(client, path);
-    ftp::OnlineTransferUpdater onlineUpdater(boost::this_thread::get_id(), stats::Direction::Upload,
+    ftp::OnlineTransferUpdater onlineUpdater(client.SessionID(), stats::Direction::Upload,
                                              data.State().StartTime());
+#if defined(EBFTPD_IO_URING)
+    ftp::UringEngine* engine = data.CanSplice() ? ftp::UringEngine::Get() : nullptr;
+    if (engine)
+    {
+      method = "io_uring";
+      crcFromFile = true;
+      // completes by throwing EndOfStream, the same as Data::Read
+      engine->Upload(data, fout->handle(), [&](size_t len)
+          {
+            data.State().Update(len);
+            buffer.Update(len);
+            onlineUpdater.Update(data.State().Bytes());
+            speedControl.Apply();
+          });
+    }
+#endif
+
+#if defined(__linux__)
+    std::unique_ptr<util::Pipe> pipe;
+    if (data.CanSplice()) pipe = SplicePipe(fout->handle());
+    
+    if (pipe)
+    {
+      method = "splice";
+      crcFromFile = true;
+      
+      while (true)
+      {
+        size_t len = data.Splice(pipe->WriteFd(), buffer.Size());
+        SpliceToFile(pipe->ReadFd(), fout->handle(), len);
+        writer.Advance(len);
+        
+        data.State().Update(len);
+        buffer.Update(len);
+        onlineUpdater.Update(data.State().Bytes());
+        speedControl.Apply();
+      }
+    }
+#endif
+
     std::vector<char> asciiBuf;
-    char buffer[bufferSize];
     
     while (true)
     {
-      size_t len = data.Read(buffer, sizeof(buffer));
+      size_t len = data.Read(buffer.Data(), buffer.Size());
       
-      char *bufp  = buffer;
+      char *bufp  = buffer.Data();
       if (data.DataType() == ftp::DataType::ASCII)
       {
-        ftp::ASCIITranscodeSTOR(buffer, len, asciiBuf);
+        ftp::ASCIITranscodeSTOR(bufp, len, asciiBuf);
         len = asciiBuf.size();
         bufp = asciiBuf.data();
       }
       
       data.State().Update(len);
+      buffer.Update(len);
       
-      fout->write(bufp, len);
+      writer.Write(bufp, len);
       
       if (calcCrc) crc32->Update(reinterpret_cast<uint8_t*>(bufp), len);
       onlineUpdater.Update(data.State().Bytes());
@@ -314,9 +433,33 @@ void STORCommand::Execute()
     aborted = true;
   }
 
+  try
+  {
+    writer.Finish();
+  }
+  catch (const std::ios_base::failure& e)
+  {
+    control.Reply(ftp::DataCloseAborted,
+                  "Error while writing to disk: " + std::string(e.what()));
+    throw cmd::NoPostScriptError();
+  }
+  
   fout->close();
   data.Close();
   
+  if (crcFromFile && calcCrc && !aborted &&
+      !CRCFromFile(fs::MakeReal(path), offset, data.State().Bytes(), *crc32,
+                   buffer.Data(), buffer.Size()))
+  {
+    logs::Error("Unable to read back upload for crc calculation: %1%", 
+                fs::MakeReal(path).ToString());
+    calcCrc = false;
+  }
+  
+  logs::Debug("Upload by %1% used %2%s user and %3%s system cpu time for %4% bytes (%5%, %6% byte buffer)",
+              client.User().Name(), cpuUsage.User(), cpuUsage.System(),
+              data.State().Bytes(), method, buffer.Size());
+  
   e = fs::Chmod(fs::MakeReal(path), completeMode);
   if (!e) control.PartReply(ftp::DataClosedOkay, "Failed to chmod upload: " + e.Message());
 
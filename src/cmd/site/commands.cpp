@@ -43,6 +43,8 @@
 #include "fs/globiterator.hpp"
 #include "fs/owner.hpp"
 #include "fs/path.hpp"
+#include "ftp/addresscache.hpp"
+#include "util/net/tlscontext.hpp"
 #include "ftp/task/task.hpp"
 #include "ftp/task/types.hpp"
 #include "ftp/xdupe.hpp"
@@ -133,6 +135,35 @@ void ADDIPCommand::Execute()
   
 } 
 
+void CACHECommand::Execute()
+{
+  ftp::AddressCache& cache = ftp::AddressCache::Get();
+  size_t hostnames, idents, capacity;
+  cache.Sizes(hostnames, idents, capacity);
+  
+  std::ostringstream os;
+  os << "Address lookup cache (" << capacity << " entries each):";
+  
+  auto counters = [&](const std::string& name, size_t size, 
+                      const ftp::AddressCache::Counters& counters)
+  {
+    os << "\n" << std::left << std::setw(10) << (name + ":")
+       << size << " cached, " << counters.hits << " hits ("
+       << counters.negativeHits << " failed lookups), " 
+       << counters.misses << " misses";
+  };
+  
+  counters("Hostnames", hostnames, cache.HostnameCounters());
+  counters("Idents", idents, cache.IdentCounters());
+  
+  os << "\nTLS sessions (" << util::net::TLSServerContext::CachedSessions() << " cached):"
+     << "\n" << std::left << std::setw(10) << "Handshakes:" 
+     << util::net::TLSContext::FullHandshakes() << " full, "
+     << util::net::TLSContext::ResumedHandshakes() << " resumed";
+  
+  control.Reply(ftp::CommandOkay, os.str());
+}
+
 void CHGADMINCommand::Execute()
 {
   acl::GroupID gid = acl::NameToGID(args[2]);
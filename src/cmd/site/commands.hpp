@@ -14,6 +14,16 @@ public:
 
   void Execute();
 };
+
+class CACHECommand : public Command
+{
+public:
+  CACHECommand(ftp::Client& client, const std::string& argStr, const Args& args) :
+    Command(client, client.Control(), client.Data(), argStr, args) { }
+
+  void Execute();
+};
+
 class CHGADMINCommand : public Command
 {
 public:
@@ -249,6 +249,10 @@ Factory::Factory()
                       nullptr,
                       "Syntax: SITE STAT",
                       "Display statline" }, },
+    { "CACHE",      { 0,  0,  "cache",
+                      std::make_shared<Creator<CACHECommand>>(),
+                      "Syntax: SITE CACHE",
+                      "Display address lookup and tls session cache statistics" }, },
     { "TIME",       { 0,  0,  "time",
                       std::make_shared<Creator<TIMECommand>>(),
                       "Syntax: SITE TIME",
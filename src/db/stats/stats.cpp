@@ -18,9 +18,9 @@ namespace db { namespace stats
 {
 
 void Update(const acl::User& user, long long kBytes, long long xfertime, 
-    const std::string& section, ::stats::Direction direction, bool decrement)
+    const std::string& section, ::stats::Direction direction, bool decrement,
+    int files = 1)
 {
-  int files = 1;
   if (decrement)
   {
     files *= -1;
@@ -105,9 +105,11 @@ void Upload(const acl::User& user, long long kBytes, long long xfertime, const s
   Update(user, kBytes, xfertime, section, ::stats::Direction::Upload, false);
 }
 
-void Download(const acl::User& user, long long kBytes, long long xfertime, const std::string& section)
+void Download(const acl::User& user, long long kBytes, long long xfertime, 
+    const std::string& section, bool countFile)
 {
-  Update(user, kBytes, xfertime, section, ::stats::Direction::Download, false);
+  Update(user, kBytes, xfertime, section, ::stats::Direction::Download, false, 
+         countFile ? 1 : 0);
 }
 
 std::vector< ::stats::Stat> RetrieveUsers(
@@ -26,7 +26,8 @@ void Upload(const acl::User& user, long long kBytes,
       long long xfertime, const std::string& section = "");
 
 void Download(const acl::User& user, long long kBytes, 
-      long long xfertime, const std::string& section = "");
+      long long xfertime, const std::string& section = "",
+      bool countFile = true);
 
 void UploadDecr(const acl::User& user, long long kBytes, 
       time_t modTime, const std::string& section = "");
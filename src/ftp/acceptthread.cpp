@@ -0,0 +1,102 @@
+#include <cerrno>
+#include <boost/thread/thread.hpp>
+#include "ftp/acceptthread.hpp"
+#include "ftp/server.hpp"
+#include "ftp/client.hpp"
+#include "ftp/task/task.hpp"
+#include "logs/logs.hpp"
+#include "util/error.hpp"
+#include "util/misc.hpp"
+
+namespace ftp
+{
+
+AcceptThread::AcceptThread(Server& server, const std::vector<std::string>& validIPs, int port) :
+  server(server),
+  shutdown(false)
+{
+  for (const auto& ip : validIPs)
+  {
+    std::unique_ptr<util::net::TCPListener> listener(new util::net::TCPListener());
+    listener->SetReusePort(true);
+    listener->Listen(util::net::Endpoint(ip, port));
+    listener->SetBlocking(false);
+    
+    struct pollfd pfd;
+    pfd.fd = listener->Socket();
+    pfd.events = POLLIN;
+    fds.push_back(pfd);
+    listeners.push_back(listener.release());
+  }
+  
+  struct pollfd pfd;
+  pfd.fd = interruptPipe.ReadFd();
+  pfd.events = POLLIN;
+  fds.push_back(pfd);
+}
+
+AcceptThread::~AcceptThread()
+{
+}
+
+void AcceptThread::Shutdown()
+{
+  shutdown = true;
+  interruptPipe.Interrupt();
+  Join();
+}
+
+void AcceptThread::AcceptBatch(util::net::TCPListener& listener, 
+                               const boost::posix_time::ptime& ready)
+{
+  // accept everything queued rather than one per wake up, capped so the
+  // other listeners aren't starved during a connection storm
+  for (int i = 0; i < maxBatch; ++i)
+  {
+    std::unique_ptr<Client> accepted;
+    if (!server.AcceptPending(listener, accepted)) break;
+    // refused by admission control or failed and logged
+    if (!accepted) continue;
+    
+    Client* client = accepted.release();
+    // the server thread takes ownership, pushed before starting so it's
+    // handled ahead of the client's own finished task
+    std::make_shared<task::ClientAccepted>(client)->Push();
+    server.StartClient(*client);
+    
+    server.acceptLatency.Record((boost::posix_time::microsec_clock::local_time() - 
+                                 ready).total_microseconds());
+  }
+}
+
+void AcceptThread::Run()
+{
+  util::SetProcessTitle("ACCEPT");
+  
+  while (!shutdown)
+  {
+    for (auto& pfd : fds) pfd.revents = 0;
+    
+    int n = poll(fds.data(), fds.size(), -1);
+    if (n < 0)
+    {
+      if (errno == EINTR) continue;
+      logs::Error("Accept thread poll failed: %1%", util::Error::Failure(errno).Message());
+      // ensure we don't poll rapidly on repeated failures
+      boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+      continue;
+    }
+    
+    auto ready = boost::posix_time::microsec_clock::local_time();
+    
+    // last pollfd is interrupt pipe
+    if (fds.back().revents & POLLIN) interruptPipe.Acknowledge();
+    
+    for (size_t i = 0; i < listeners.size(); ++i)
+    {
+      if (fds[i].revents & POLLIN) AcceptBatch(listeners[i], ready);
+    }
+  }
+}
+
+} /* ftp namespace */
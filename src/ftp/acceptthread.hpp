@@ -0,0 +1,47 @@
+#ifndef __FTP_ACCEPTTHREAD_HPP
+#define __FTP_ACCEPTTHREAD_HPP
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "util/thread.hpp"
+#include "util/interruptpipe.hpp"
+#include "util/net/tcplistener.hpp"
+
+namespace ftp
+{
+
+class Client;
+class Server;
+
+// one of several threads each with its own SO_REUSEPORT listener on every
+// valid ip, the kernel spreads incoming connections between them
+class AcceptThread : public util::Thread
+{
+  Server& server;
+  boost::ptr_vector<util::net::TCPListener> listeners;
+  std::vector<struct pollfd> fds;
+  util::InterruptPipe interruptPipe;
+  std::atomic_bool shutdown;
+  
+  static const int maxBatch = 64;
+  
+  void AcceptBatch(util::net::TCPListener& listener, 
+                   const boost::posix_time::ptime& ready);
+  void Run();
+  
+public:
+  AcceptThread(Server& server, const std::vector<std::string>& validIPs, int port);
+  /* Throws NetworkError */
+  ~AcceptThread();
+  
+  void Shutdown();
+};
+
+} /* ftp namespace */
+
+#endif
@@ -0,0 +1,92 @@
+#include <stdexcept>
+#include "ftp/addresscache.hpp"
+
+namespace ftp
+{
+
+std::unique_ptr<AddressCache> AddressCache::instance;
+boost::once_flag AddressCache::instanceOnce = BOOST_ONCE_INIT;
+
+void AddressCache::Resize(int size)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (size <= 0)
+  {
+    hostnames.reset();
+    idents.reset();
+  }
+  else if (!hostnames || hostnames->Capacity() != static_cast<size_t>(size))
+  {
+    hostnames.reset(new Cache(size));
+    idents.reset(new Cache(size));
+  }
+}
+
+bool AddressCache::Lookup(Cache* cache, Counters& counters, const std::string& key,
+                          const std::string& negative, std::string& value)
+{
+  if (!cache) return false;
+
+  try
+  {
+    Entry& entry = cache->Lookup(key);
+    if (entry.expires > boost::posix_time::second_clock::local_time())
+    {
+      value = entry.value;
+      ++counters.hits;
+      if (value == negative) ++counters.negativeHits;
+      return true;
+    }
+    cache->Flush(key);
+  }
+  catch (const std::out_of_range&)
+  {
+  }
+
+  ++counters.misses;
+  return false;
+}
+
+void AddressCache::Insert(Cache* cache, const std::string& key, const std::string& value,
+                          int ttl)
+{
+  if (!cache || ttl <= 0) return;
+  cache->Insert(key, Entry(value, boost::posix_time::second_clock::local_time() +
+                                  boost::posix_time::seconds(ttl)));
+}
+
+bool AddressCache::LookupHostname(const std::string& ip, std::string& hostname)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return Lookup(hostnames.get(), hostnameCounters, ip, ip, hostname);
+}
+
+void AddressCache::InsertHostname(const std::string& ip, const std::string& hostname,
+                                  int ttl, int negativeTTL)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  Insert(hostnames.get(), ip, hostname, hostname == ip ? negativeTTL : ttl);
+}
+
+bool AddressCache::LookupIdent(const std::string& ip, std::string& ident)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return Lookup(idents.get(), identCounters, ip, "", ident);
+}
+
+void AddressCache::InsertIdent(const std::string& ip, const std::string& ident, int negativeTTL)
+{
+  if (!ident.empty()) return;
+  std::lock_guard<std::mutex> lock(mutex);
+  Insert(idents.get(), ip, ident, negativeTTL);
+}
+
+void AddressCache::Sizes(size_t& hostnames, size_t& idents, size_t& capacity)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  hostnames = this->hostnames ? this->hostnames->Size() : 0;
+  idents = this->idents ? this->idents->Size() : 0;
+  capacity = this->hostnames ? this->hostnames->Capacity() : 0;
+}
+
+} /* ftp namespace */
@@ -0,0 +1,90 @@
+#ifndef __FTP_ADDRESSCACHE_HPP
+#define __FTP_ADDRESSCACHE_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <boost/thread/once.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "util/lrucache.hpp"
+
+namespace ftp
+{
+
+// hostnames from recent lookups shared between sessions, failed lookups are
+// kept too, as are failed ident lookups so an address with no ident server
+// doesn't hold up every one of its connections. an ident names the user of
+// one connection so a successful one is never reused
+class AddressCache
+{
+public:
+  struct Counters
+  {
+    std::atomic<unsigned long long> hits;
+    std::atomic<unsigned long long> negativeHits;
+    std::atomic<unsigned long long> misses;
+
+    Counters() : hits(0), negativeHits(0), misses(0) { }
+  };
+
+private:
+  struct Entry
+  {
+    std::string value;
+    boost::posix_time::ptime expires;
+
+    Entry(const std::string& value, const boost::posix_time::ptime& expires) :
+      value(value), expires(expires) { }
+  };
+
+  typedef util::LRUCache<std::string, Entry> Cache;
+
+  std::mutex mutex;
+  std::unique_ptr<Cache> hostnames;
+  std::unique_ptr<Cache> idents;
+  Counters hostnameCounters;
+  Counters identCounters;
+
+  static std::unique_ptr<AddressCache> instance;
+  static boost::once_flag instanceOnce;
+
+  static void CreateInstance() { instance.reset(new AddressCache()); }
+
+  AddressCache() = default;
+
+  bool Lookup(Cache* cache, Counters& counters, const std::string& key,
+              const std::string& negative, std::string& value);
+  void Insert(Cache* cache, const std::string& key, const std::string& value,
+              int ttl);
+
+public:
+  void Resize(int size);
+  /* Empties the caches if size has changed, 0 disables */
+
+  bool LookupHostname(const std::string& ip, std::string& hostname);
+  /* A failed lookup returns the ip as the hostname */
+  void InsertHostname(const std::string& ip, const std::string& hostname, int ttl, int negativeTTL);
+  /* A hostname the same as the ip is a failed lookup */
+
+  bool LookupIdent(const std::string& ip, std::string& ident);
+  /* Only failed lookups are found, returning an empty ident */
+  void InsertIdent(const std::string& ip, const std::string& ident, int negativeTTL);
+  /* Ignored unless ident is empty, a failed lookup */
+
+  /* Lookups return true if found and not expired, all no exceptions */
+
+  const Counters& HostnameCounters() const { return hostnameCounters; }
+  const Counters& IdentCounters() const { return identCounters; }
+  void Sizes(size_t& hostnames, size_t& idents, size_t& capacity);
+
+  static AddressCache& Get()
+  {
+    boost::call_once(&CreateInstance, instanceOnce);
+    return *instance;
+  }
+};
+
+} /* ftp namespace */
+
+#endif
@@ -0,0 +1,136 @@
+#include <boost/bind.hpp>
+#include <boost/thread/thread_time.hpp>
+#include "ftp/addresslookup.hpp"
+#include "ftp/addresscache.hpp"
+#include "ftp/lookuppool.hpp"
+#include "cfg/get.hpp"
+#include "util/net/resolver.hpp"
+#include "util/net/identclient.hpp"
+#include "util/net/error.hpp"
+#include "logs/logs.hpp"
+
+namespace ftp
+{
+
+AddressLookup::AddressLookup(const util::net::Endpoint& local, const util::net::Endpoint& remote,
+                             bool hostname, bool ident, int timeout) :
+  state(std::make_shared<State>(!hostname, !ident)),
+  deadline(boost::get_system_time() + boost::posix_time::seconds(timeout))
+{
+  util::net::IPAddress ip = remote.IP().IsMappedv4() ? remote.IP().ToUnmappedv4() : remote.IP();
+  if (hostname) unresolved = ip.ToString();
+  
+  const cfg::AddressCache& cacheConfig = cfg::Get().AddressCache();
+  AddressCache& cache = AddressCache::Get();
+  cache.Resize(cacheConfig.Size());
+  
+  // no need to lock, nothing is queued yet
+  if (hostname && cache.LookupHostname(ip.ToString(), state->hostname))
+  {
+    state->hostnameDone = true;
+    hostname = false;
+  }
+  
+  if (ident && cache.LookupIdent(ip.ToString(), state->ident))
+  {
+    state->identDone = true;
+    ident = false;
+  }
+  
+  // when a pool is backed up the lookup is skipped as though it failed
+  if (hostname && !LookupPool::Hostname().Queue(
+          boost::bind(&AddressLookup::LookupHostname, state, ip, deadline, cacheConfig)))
+  {
+    logs::Error("Unable to queue hostname lookup for connection from %1%", remote);
+    boost::lock_guard<boost::mutex> lock(state->mutex);
+    state->hostname = unresolved;
+    state->hostnameDone = true;
+  }
+  
+  if (ident && !LookupPool::Ident().Queue(
+          boost::bind(&AddressLookup::LookupIdent, state, local, remote, deadline, cacheConfig)))
+  {
+    logs::Error("Unable to queue ident lookup for connection from %1%", remote);
+    boost::lock_guard<boost::mutex> lock(state->mutex);
+    state->identDone = true;
+  }
+}
+
+void AddressLookup::LookupHostname(std::shared_ptr<State> state, util::net::IPAddress ip,
+                                   boost::posix_time::ptime deadline,
+                                   cfg::AddressCache cacheConfig)
+{
+  std::string hostname;
+  // nobody is waiting on a lookup that sat in the queue past its deadline
+  if (boost::get_system_time() >= deadline) hostname = ip.ToString();
+  else
+  {
+    // returns the ip when there's no name for it
+    hostname = util::net::ReverseResolve(ip);
+    AddressCache::Get().InsertHostname(ip.ToString(), hostname, cacheConfig.TTL(), 
+                                       cacheConfig.NegativeTTL());
+  }
+
+  boost::lock_guard<boost::mutex> lock(state->mutex);
+  state->hostname = hostname;
+  state->hostnameDone = true;
+  state->cond.notify_all();
+}
+
+void AddressLookup::LookupIdent(std::shared_ptr<State> state, util::net::Endpoint local,
+                                util::net::Endpoint remote,
+                                boost::posix_time::ptime deadline,
+                                cfg::AddressCache cacheConfig)
+{
+  std::string ident;
+  auto remaining = deadline - boost::get_system_time();
+  if (remaining > boost::posix_time::seconds(0))
+  {
+    try
+    {
+      // no longer than the login would wait for it, so a job that sat in
+      // the queue doesn't hold its thread past the deadline
+      util::net::IdentClient identClient(local, remote, util::TimePair(remaining));
+      ident = identClient.Ident();
+    }
+    catch (const util::net::NetworkError& e)
+    {
+      logs::Error("Unable to lookup ident for connection from %1%: %2%", remote, e.Message());
+    }
+    
+    util::net::IPAddress ip = remote.IP().IsMappedv4() ? remote.IP().ToUnmappedv4() : remote.IP();
+    AddressCache::Get().InsertIdent(ip.ToString(), ident, cacheConfig.NegativeTTL());
+  }
+
+  boost::lock_guard<boost::mutex> lock(state->mutex);
+  state->ident = ident;
+  state->identDone = true;
+  state->cond.notify_all();
+}
+
+bool AddressLookup::WaitHostname(std::string& hostname)
+{
+  boost::unique_lock<boost::mutex> lock(state->mutex);
+  while (!state->hostnameDone)
+  {
+    if (!state->cond.timed_wait(lock, deadline)) break;
+  }
+
+  hostname = state->hostnameDone ? state->hostname : unresolved;
+  return state->hostnameDone;
+}
+
+bool AddressLookup::Wait(std::string& hostname, std::string& ident)
+{
+  boost::unique_lock<boost::mutex> lock(state->mutex);
+  while (!state->hostnameDone || !state->identDone)
+  {
+    if (!state->cond.timed_wait(lock, deadline)) break;
+  }
+
+  hostname = state->hostnameDone ? state->hostname : unresolved;
+  ident = state->ident;
+  return state->hostnameDone && state->identDone;
+}
+
+} /* ftp namespace */
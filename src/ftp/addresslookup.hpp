@@ -0,0 +1,65 @@
+#ifndef __FTP_ADDRESSLOOKUP_HPP
+#define __FTP_ADDRESSLOOKUP_HPP
+
+#include <memory>
+#include <string>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "util/net/endpoint.hpp"
+#include "cfg/setting.hpp"
+
+namespace ftp
+{
+
+// reverse dns and ident lookups for a new connection, each queued on its
+// LookupPool so they overlap each other and the banner, and waited on only
+// once their results are needed
+class AddressLookup
+{
+  // shared with the queued lookups which are left to finish on their own
+  // if the deadline passes or the client goes away first
+  struct State
+  {
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    bool hostnameDone;
+    bool identDone;
+    std::string hostname;
+    std::string ident;
+
+    State(bool hostnameDone, bool identDone) :
+      hostnameDone(hostnameDone), identDone(identDone) { }
+  };
+
+  std::shared_ptr<State> state;
+  boost::posix_time::ptime deadline;
+  // hostname when its lookup doesn't finish in time, as when it fails
+  std::string unresolved;
+
+  static void LookupHostname(std::shared_ptr<State> state, util::net::IPAddress ip,
+                             boost::posix_time::ptime deadline,
+                             cfg::AddressCache cacheConfig);
+  static void LookupIdent(std::shared_ptr<State> state, util::net::Endpoint local,
+                          util::net::Endpoint remote,
+                          boost::posix_time::ptime deadline,
+                          cfg::AddressCache cacheConfig);
+
+public:
+  AddressLookup(const util::net::Endpoint& local, const util::net::Endpoint& remote,
+                bool hostname, bool ident, int timeout);
+  /* Only the lookups requested and not in AddressCache are started, */
+  /* timeout is in seconds */
+  /* No exceptions */
+
+  bool WaitHostname(std::string& hostname);
+  bool Wait(std::string& hostname, std::string& ident);
+  /* Wait until the lookups complete or the deadline passes, returning false */
+  /* if it passed, hostname is then the ip as when it can't be resolved and */
+  /* ident is left empty, as are the results of lookups not requested */
+  /* No exceptions */
+};
+
+} /* ftp namespace */
+
+#endif
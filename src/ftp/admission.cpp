@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "ftp/admission.hpp"
+#include "cfg/get.hpp"
+
+namespace ftp
+{
+
+Admission::Admission() :
+  rejectedConnections(0),
+  rejectedRate(0)
+{
+}
+
+void Admission::Refill(Entry& entry, int perMinute, const boost::posix_time::ptime& now)
+{
+  if (entry.lastRefill.is_not_a_date_time())
+    entry.tokens = perMinute;
+  else
+  {
+    double elapsed = (now - entry.lastRefill).total_milliseconds() / 1000.0;
+    entry.tokens = std::min<double>(perMinute, entry.tokens + elapsed * perMinute / 60.0);
+  }
+  entry.lastRefill = now;
+}
+
+void Admission::Prune(const boost::posix_time::ptime& now)
+{
+  if (!nextPrune.is_not_a_date_time() && now < nextPrune) return;
+  nextPrune = now + boost::posix_time::seconds(pruneInterval);
+
+  // a minute without activity refills any rate limit completely so
+  // there's nothing to remember about an entry with no connections
+  auto cutoff = now - boost::posix_time::minutes(1);
+  for (auto it = entries.begin(); it != entries.end();)
+  {
+    if (it->second.connections == 0 && 
+        (it->second.lastRefill.is_not_a_date_time() || it->second.lastRefill <= cutoff))
+      it = entries.erase(it);
+    else
+      ++it;
+  }
+}
+
+AdmissionResult Admission::Admit(const util::net::IPAddress& ip, Keys& keys)
+{
+  keys.clear();
+
+  // the accepting threads never run commands, pick up reloads here instead
+  cfg::UpdateLocal();
+  const std::vector<cfg::ConnectionLimit>& limits = cfg::Get().ConnectionLimits();
+  if (limits.empty()) return AdmissionResult::Admitted;
+
+  util::net::IPAddress unmapped = ip.IsMappedv4() ? ip.ToUnmappedv4() : ip;
+  int addressBits = unmapped.Length() * 8;
+  auto now = boost::posix_time::microsec_clock::local_time();
+
+  std::vector<std::pair<Entry*, const cfg::ConnectionLimit*>> matched;
+  std::lock_guard<std::mutex> lock(mutex);
+  Prune(now);
+
+  for (const auto& limit : limits)
+  {
+    std::string key;
+    if (limit.Wildcard())
+    {
+      if (limit.PrefixLen() > addressBits) continue;
+      int prefixLen = limit.PrefixLen() < 0 ? addressBits : limit.PrefixLen();
+      key = limit.Mask() + " " + unmapped.Masked(prefixLen).ToString();
+    }
+    else
+    {
+      int prefixLen = limit.PrefixLen() < 0 ? addressBits : limit.PrefixLen();
+      if (prefixLen > addressBits ||
+          unmapped.Masked(prefixLen).ToString() != limit.Network()) continue;
+      key = limit.Mask();
+    }
+
+    Entry& entry = entries[key];
+    if (limit.PerMinute() >= 0) Refill(entry, limit.PerMinute(), now);
+
+    if (limit.MaxConnections() >= 0 && entry.connections >= limit.MaxConnections())
+    {
+      ++rejectedConnections;
+      keys.clear();
+      return AdmissionResult::TooManyConnections;
+    }
+
+    if (limit.PerMinute() >= 0 && entry.tokens < 1)
+    {
+      ++rejectedRate;
+      keys.clear();
+      return AdmissionResult::TooFast;
+    }
+
+    matched.emplace_back(&entry, &limit);
+    keys.emplace_back(std::move(key));
+  }
+
+  // only counted once every limit has agreed to it
+  for (auto& match : matched)
+  {
+    ++match.first->connections;
+    if (match.second->PerMinute() >= 0) match.first->tokens -= 1;
+    else match.first->lastRefill = now;
+  }
+
+  return AdmissionResult::Admitted;
+}
+
+void Admission::Bind(const Client& client, const Keys& keys)
+{
+  if (keys.empty()) return;
+  std::lock_guard<std::mutex> lock(mutex);
+  clients[&client] = keys;
+}
+
+void Admission::ReleaseLocked(const Keys& keys)
+{
+  for (const auto& key : keys)
+  {
+    auto it = entries.find(key);
+    if (it != entries.end() && it->second.connections > 0)
+      --it->second.connections;
+  }
+}
+
+void Admission::Release(const Keys& keys)
+{
+  if (keys.empty()) return;
+  std::lock_guard<std::mutex> lock(mutex);
+  ReleaseLocked(keys);
+}
+
+void Admission::Release(const Client& client)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = clients.find(&client);
+  if (it == clients.end()) return;
+  ReleaseLocked(it->second);
+  clients.erase(it);
+}
+
+void Admission::Refuse(int socket, AdmissionResult result)
+{
+  const char* reply = result == AdmissionResult::TooFast ?
+      "421 Connecting too frequently from your address, try again later.\r\n" :
+      "421 Too many connections from your address.\r\n";
+
+  int flags = MSG_DONTWAIT;
+#if defined(MSG_NOSIGNAL)
+  flags |= MSG_NOSIGNAL;
+#endif
+
+  // best effort, a full send buffer on a brand new connection means
+  // the client isn't reading anyway
+  (void) send(socket, reply, strlen(reply), flags);
+  close(socket);
+}
+
+} /* ftp namespace */
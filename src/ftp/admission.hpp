@@ -0,0 +1,81 @@
+#ifndef __FTP_ADMISSION_HPP
+#define __FTP_ADMISSION_HPP
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "util/net/ipaddress.hpp"
+
+namespace ftp
+{
+
+class Client;
+
+enum class AdmissionResult
+{
+  Admitted,
+  TooManyConnections,
+  TooFast
+};
+
+// per address and network limits from connection_limit, checked against the
+// raw accepted socket so a refused connection costs no more than a few map
+// lookups and a one line reply
+class Admission
+{
+public:
+  typedef std::vector<std::string> Keys;
+
+private:
+  struct Entry
+  {
+    int connections;
+    double tokens;
+    boost::posix_time::ptime lastRefill;
+
+    Entry() : connections(0), tokens(0) { }
+  };
+
+  std::mutex mutex;
+  std::unordered_map<std::string, Entry> entries;
+  std::unordered_map<const Client*, Keys> clients;
+  boost::posix_time::ptime nextPrune;
+
+  std::atomic<unsigned long long> rejectedConnections;
+  std::atomic<unsigned long long> rejectedRate;
+
+  static const int pruneInterval = 60; // seconds
+
+  void Refill(Entry& entry, int perMinute, const boost::posix_time::ptime& now);
+  void Prune(const boost::posix_time::ptime& now);
+  void ReleaseLocked(const Keys& keys);
+
+public:
+  Admission();
+
+  AdmissionResult Admit(const util::net::IPAddress& ip, Keys& keys);
+  /* When admitted the connection is counted against every matching limit */
+  /* and keys identifies those counts for Bind or Release */
+  /* No exceptions */
+
+  void Bind(const Client& client, const Keys& keys);
+  /* Ties admitted counts to the client so they're released with it */
+  /* No exceptions */
+
+  void Release(const Keys& keys);
+  void Release(const Client& client);
+  /* No exceptions */
+
+  unsigned long long RejectedConnections() const { return rejectedConnections; }
+  unsigned long long RejectedRate() const { return rejectedRate; }
+
+  static void Refuse(int socket, AdmissionResult result);
+  /* Sends a 421 reply without blocking and closes socket, No exceptions */
+};
+
+} /* ftp namespace */
+
+#endif
@@ -1,5 +1,6 @@
 #include "ftp/client.hpp"
 #include "ftp/clientimpl.hpp"
+#include "ftp/sessionpool.hpp"
 
 namespace ftp
 {
@@ -23,9 +24,29 @@ const acl::User& Client::User() const
   return pimpl->User();
 }
 
-bool Client::Accept(util::net::TCPListener& server)
+bool Client::Accept(int socket)
 {
-  return pimpl->Accept(server);
+  return pimpl->Accept(socket);
+}
+
+bool Client::Dispatch(bool idleTimeout)
+{
+  return pimpl->Dispatch(idleTimeout);
+}
+
+void Client::Finish()
+{
+  pimpl->Finish();
+}
+
+bool Client::IdleExpired() const
+{
+  return pimpl->IdleExpired();
+}
+
+long Client::SessionID() const
+{
+  return pimpl->SessionID();
 }
 
 /*bool Client::IsFinished() const
@@ -229,9 +250,15 @@ void Client::Start()
   pimpl->Start();
 }
 
+void Client::RunSession()
+{
+  pimpl->RunSession();
+}
+
 void Client::Join()
 {
   pimpl->Join();
+  SessionPool::Get().Join(*this);
 }
 
 bool Client::TryJoin()
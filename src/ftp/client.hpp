@@ -30,7 +30,6 @@ namespace util
 class ProcessReader;
 namespace net
 {
-class TCPListener;
 class Endpoint;
 }
 }
@@ -58,7 +57,11 @@ public:
   acl::User& User();
   const acl::User& User() const;
   
-  bool Accept(util::net::TCPListener& server);
+  bool Accept(int socket);
+  bool Dispatch(bool idleTimeout);
+  void Finish();
+  bool IdleExpired() const;
+  long SessionID() const;
   bool IsFinished() const;
   void SetLoggedIn(bool kicked);
   void SetWaitingPassword(const acl::User& user, bool kickLogin);
@@ -110,6 +113,8 @@ public:
   void SetUserUpdated();
   
   void Start();
+  void RunSession();
+  /* Runs the session on the calling thread, for SessionPool */
   void Join();
   bool TryJoin();
 };
@@ -15,7 +15,6 @@
 #include "cfg/get.hpp"
 #include "util/misc.hpp"
 #include "main.hpp"
-#include "util/net/identclient.hpp"
 #include "util/string.hpp"
 #include "ftp/counter.hpp"
 #include "acl/flags.hpp"
@@ -24,17 +23,18 @@
 #include "ftp/error.hpp"
 #include "cmd/error.hpp"
 #include "exec/cscript.hpp"
-#include "util/net/resolver.hpp"
 #include "acl/misc.hpp"
 #include "util/misc.hpp"
 #include "ftp/task/task.hpp"
 #include "ftp/online.hpp"
+#include "ftp/sessionpool.hpp"
 #include "fs/directory.hpp"
 
 namespace ftp
 {
 
 std::atomic_bool ClientImpl::siteopOnly(false);
+std::atomic<long> ClientImpl::nextSessionID(1);
 
 ClientImpl::ClientImpl(Client& parent) :
   parent(parent),
@@ -45,7 +45,9 @@ ClientImpl::ClientImpl(Client& parent) :
   xdupeMode(xdupe::Mode::Disabled),
   kickLogin(false),
   idleTimeout(boost::posix_time::seconds(cfg::Get().IdleTimeout().Timeout())),
-  ident("*")
+  ident("*"),
+  sessionID(nextSessionID++),
+  prepared(false)
 {
 }
 
@@ -75,7 +77,6 @@ void ClientImpl::SetState(ClientState state)
                  logs::QuoteOn(), "user", user->Name(), 
                 "group", user->PrimaryGroup(), 
                 "tagline", user->Tagline());
-    OnlineWriter::Get().LoggedOut(boost::this_thread::get_id());
   }
 }
 
@@ -117,7 +118,7 @@ void ClientImpl::SetLoggedIn(bool kicked)
               "group", user->PrimaryGroup(), 
               "tagline", user->Tagline());
               
-  OnlineWriter::Get().LoggedIn(boost::this_thread::get_id(), parent, fs::WorkDirectory().ToString());
+  OnlineWriter::Get().LoggedIn(sessionID, parent, fs::WorkDirectory().ToString());
 }
 
 void ClientImpl::SetWaitingPassword(const acl::User& user, bool kickLogin)
@@ -128,6 +129,8 @@ void ClientImpl::SetWaitingPassword(const acl::User& user, bool kickLogin)
     this->user = std::move(user);
     this->kickLogin = kickLogin;
   }
+  
+  std::make_shared<ftp::task::ClientWaitingPassword>(parent, user.ID())->Push();
 }
 
 bool ClientImpl::CheckState(ClientState reqdState)
@@ -164,11 +167,11 @@ bool ClientImpl::PasswordAttemptsExceeded() const
   return passwordAttemps >= maxPasswordAttemps;
 }
 
-bool ClientImpl::Accept(util::net::TCPListener& server)
+bool ClientImpl::Accept(int socket)
 {
   try
   {
-    control.Accept(server);
+    control.Accept(socket);
     ip = control.RemoteEndpoint().IP().IsMappedv4() ?
          control.RemoteEndpoint().IP().ToUnmappedv4().ToString() :
          control.RemoteEndpoint().IP().ToString();
@@ -223,7 +226,7 @@ void ClientImpl::ExecuteCommand(const std::string& commandLine)
   
   if (State() == ClientState::LoggedIn)
   {
-    OnlineWriter::Get().Command(boost::this_thread::get_id(), currentCommand);
+    OnlineWriter::Get().Command(sessionID, currentCommand);
   }
   
   cmd::rfc::CommandDefOptRef def(cmd::rfc::Factory::Lookup(args[0]));
@@ -272,7 +275,7 @@ void ClientImpl::ExecuteCommand(const std::string& commandLine)
   
   if (State() == ClientState::LoggedIn)
   {
-    OnlineWriter::Get().Idle(boost::this_thread::get_id());
+    OnlineWriter::Get().Idle(sessionID);
   }
 }
 
@@ -304,6 +307,16 @@ bool ClientImpl::ReloadUser()
   return true;
 }
 
+void ClientImpl::HandleCommand(const boost::posix_time::time_duration* timeout)
+{
+  std::string command = control.NextCommand(timeout);    
+  if (userUpdated && !ReloadUser()) return;
+  ExecuteCommand(command);
+  // anything left is held only while there are pipelined commands to follow
+  if (!control.CommandPending() || State() == ClientState::Finished) control.Flush();
+  cfg::UpdateLocal();
+}
+
 void ClientImpl::Handle()
 {
   namespace pt = boost::posix_time;
@@ -321,36 +334,53 @@ void ClientImpl::Handle()
       timeoutPtr = &timeout;
     }
     
-    std::string command = control.NextCommand(timeoutPtr);    
-    if (userUpdated && !ReloadUser()) break;
-    ExecuteCommand(command);
-    cfg::UpdateLocal();
+    HandleCommand(timeoutPtr);
   }
 }
 
+bool ClientImpl::IdleExpired() const
+{
+  if (State() != ClientState::LoggedIn || user->IdleTime() == 0) return false;
+  return boost::posix_time::second_clock::local_time() >= idleExpires;
+}
+
 void ClientImpl::Interrupt()
 {
   SetState(ClientState::Finished);
   Stop();
+  SessionPool::Get().Interrupt(parent);
   control.Interrupt();
   data.Interrupt();
   child.Interrupt();
 }
 
-void ClientImpl::LookupIdent()
+void ClientImpl::StartLookups()
 {
-  if (!cfg::Get().IdentLookup() || ident != "*") return;
+  const cfg::Config& config = cfg::Get();
+  bool hostnameLookup = config.DNSLookup() && hostname.empty();
+  bool identLookup = config.IdentLookup() && ident == "*";
+  if (!hostnameLookup && !identLookup) return;
   
-  try
-  {
-    util::net::IdentClient identClient(control.LocalEndpoint(), control.RemoteEndpoint());
-    ident = identClient.Ident();
-  }
-  catch (util::net::NetworkError& e)
+  addressLookup.reset(new AddressLookup(control.LocalEndpoint(), control.RemoteEndpoint(),
+                                        hostnameLookup, identLookup, config.LookupTimeout()));
+}
+
+void ClientImpl::AwaitLookups()
+{
+  if (!addressLookup) return;
+  
+  std::string hostname;
+  std::string ident;
+  if (!addressLookup->Wait(hostname, ident))
   {
-    logs::Error("Unable to lookup ident for connection from %1%: %2%",
-                control.RemoteEndpoint(), e.Message());
+    logs::Debug("Timeout while waiting for address lookups for connection from %1%", 
+                control.RemoteEndpoint());
   }
+  addressLookup.reset();
+  
+  std::lock_guard<std::mutex> lock(mutex);
+  if (this->hostname.empty()) this->hostname = hostname;
+  if (!ident.empty()) this->ident = ident;
 }
 
 bool ClientImpl::ConfirmCommand(const std::string& argStr)
@@ -374,13 +404,18 @@ void ClientImpl::LogTraffic() const
 
 bool ClientImpl::PostCheckAddress()
 {
+  AwaitLookups();
   return acl::IdentIPAllowed(user->ID(), ident + "@" + IP()) ||
         (IP() != Hostname() && acl::IdentIPAllowed(user->ID(), ident + "@" + Hostname()));
 }
 
 bool ClientImpl::PreCheckAddress()
 {
-  if (!acl::IPAllowed(IP()) && (IP() != Hostname() && !acl::IPAllowed(Hostname())))
+  // only wait on the hostname when the ip alone isn't enough
+  if (acl::IPAllowed(IP())) return true;
+  
+  HostnameLookup();
+  if (IP() != Hostname() && !acl::IPAllowed(Hostname()))
   {
     logs::Security("BADADDRESS", "Refused connection from unknown address: %1%", HostnameAndIP(LogAddresses::Error));
     return false;
@@ -391,25 +426,13 @@ bool ClientImpl::PreCheckAddress()
 
 void ClientImpl::HostnameLookup()
 {
-  if (!cfg::Get().DNSLookup() || !hostname.empty()) return;
+  if (!addressLookup) return;
   
-  try
-  { 
+  std::string hostname;
+  addressLookup->WaitHostname(hostname);
   
-    std::string hostname = util::net::ReverseResolve(util::net::IPAddress(ip));
-    
-    {
-      std::lock_guard<std::mutex> lock(mutex);
-      this->hostname = hostname;
-    }
-  }
-  catch (const util::net::NetworkError&)
-  {
-    {
-      std::lock_guard<std::mutex> lock(mutex);
-      this->hostname = ip;
-    }
-  }
+  std::lock_guard<std::mutex> lock(mutex);
+  if (this->hostname.empty()) this->hostname = hostname;
 }
 
 std::string ClientImpl::SanitiseAddress(std::string address, LogAddresses log) const
@@ -510,15 +533,17 @@ bool ClientImpl::IdntParse(const std::string& command)
   return IdntUpdate(ident, ip, hostname);
 }
 
-void ClientImpl::InnerRun()
+bool ClientImpl::Prepare()
 {
   if (!cfg::Get().IsBouncer(ip))
   {
     if (cfg::Get().BouncerOnly() && !control.RemoteEndpoint().IP().IsLoopback())
     {
       logs::Security("NONBOUNCER", "Refused connection not from a bouncer address: %1%", HostnameAndIP(LogAddresses::Error));
-      return;
+      return false;
     }
+    
+    StartLookups();
   }
   else
   {
@@ -528,44 +553,104 @@ void ClientImpl::InnerRun()
       if (cfg::Get().BouncerOnly())
       {
         logs::Security("IDNTTIMEOUT", "Timeout while waiting for IDNT command from bouncer: ", HostnameAndIP(LogAddresses::Error));
-        return;
+        return false;
       }
+      
+      StartLookups();
     }
     else
     if (!IdntParse(command))
     {
       logs::Security("BADIDNT", "Malformed IDNT command from bouncer: ", HostnameAndIP(LogAddresses::Error));
-      return;
+      return false;
     }
   }
 
-  HostnameLookup();
-
-  if (!PreCheckAddress()) return;
-  
-  LookupIdent();
+  if (!PreCheckAddress()) return false;
   
-  logs::Debug("Servicing client connected from %1%@%2%", ident, HostnameAndIP(LogAddresses::Normal));
+  // ident and hostname may still be pending, they're waited on at login
+  logs::Debug("Servicing client connected from %1%", HostnameAndIP(LogAddresses::Normal));
     
   DisplayBanner();
-  Handle();
+  return true;
+}
+
+void ClientImpl::InnerRun()
+{
+  if (Prepare()) Handle();
+}
+
+void ClientImpl::Finish()
+{
+  SetState(ClientState::Finished);
+  // the online slot is freed here rather than on logout as a kick changes
+  // state from the server thread while this session may still be writing it
+  OnlineWriter::Get().LoggedOut(sessionID);
+  if (user) db::mail::LogOffPurgeTrash(user->ID());
+  LogTraffic();
+  // must be last, the server may destroy this client as soon as it's pushed
+  std::make_shared<ftp::task::ClientFinished>(parent)->Push();
+}
+
+bool ClientImpl::Dispatch(bool idleTimeout)
+{
+  if (workDir) fs::SetWorkDirectory(*workDir);
+  
+  bool okay = HandleErrors([&]
+  {
+    if (idleTimeout) throw util::net::TimeoutError();
+    
+    if (!prepared)
+    {
+      prepared = true;
+      if (!Prepare())
+      {
+        SetState(ClientState::Finished);
+        return;
+      }
+      
+      // a bouncer can send the first command along with IDNT, it's then
+      // already buffered and the socket won't be reported readable for it
+      if (!control.CommandPending()) return;
+    }
+    
+    while (State() != ClientState::Finished)
+    {
+      HandleCommand(nullptr);
+      if (!control.BufferCommand()) break;
+    }
+  });
+  
+  if (State() == ClientState::LoggedIn) workDir.reset(fs::WorkDirectory());
+  return okay && State() != ClientState::Finished;
 }
 
 void ClientImpl::Run()
 {
   util::SetProcessTitle("CLIENT");
   
-  auto finishedGuard = util::MakeScopeExit([&]
+  auto finishedGuard = util::MakeScopeExit([&] { Finish(); });
+  HandleErrors([&] { InnerRun(); });
+  (void) finishedGuard; /* silence unused variable warning */
+}
+
+void ClientImpl::RunSession()
+{
+  try
   {
-    SetState(ClientState::Finished);
-    std::make_shared<ftp::task::ClientFinished>(parent)->Push();
-    if (user) db::mail::LogOffPurgeTrash(user->ID());
-    LogTraffic();
-  });
+    Run();
+  }
+  catch (const boost::thread_interrupted&)
+  {
+  }
+}
 
- try
+bool ClientImpl::HandleErrors(const std::function<void()>& function)
+{
+  try
   {
-    InnerRun();
+    function();
+    return true;
   }
   catch (const util::net::TimeoutError& e)
   {
@@ -590,7 +675,7 @@ void ClientImpl::Run()
     logs::Error("Unhandled error on client thread: Not descended from std::exception");
   }
   
-  (void) finishedGuard; /* silence unused variable warning */
+  return false;
 }
 
 } /* ftp namespace */
@@ -4,6 +4,7 @@
 #include <string>
 #include <atomic>
 #include <mutex>
+#include <functional>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/optional.hpp>
 #include "acl/user.hpp"
@@ -16,15 +17,7 @@
 #include "ftp/xdupe.hpp"
 #include "util/processreader.hpp"
 #include "ftp/enums.hpp"
-
-namespace util
-{
-namespace net
-{
-class TCPListener;
-}
-}
-
+#include "ftp/addresslookup.hpp"
 
 namespace ftp 
 {
@@ -58,18 +51,28 @@ class ClientImpl : public util::Thread
   std::string ident;
   std::string ip;
   std::string hostname;
+  std::unique_ptr<AddressLookup> addressLookup;
+  
+  long sessionID;
+  bool prepared;
+  boost::optional<fs::VirtualPath> workDir;
   
   static std::atomic_bool siteopOnly;
+  static std::atomic<long> nextSessionID;
   
   static const int maxPasswordAttemps = 3;
   
   void DisplayBanner();
   void ExecuteCommand(const std::string& commandLine);
+  void HandleCommand(const boost::posix_time::time_duration* timeout);
   void Handle();
   bool CheckState(ClientState reqdState);
+  bool Prepare();
   void InnerRun();
+  bool HandleErrors(const std::function<void()>& function);
   void Run();
-  void LookupIdent();
+  void StartLookups();
+  void AwaitLookups();
   void IdleReset(std::string commandLine)  ;
   bool ReloadUser();
   std::string SanitiseAddress(std::string address, LogAddresses log) const;
@@ -86,7 +89,11 @@ public:
   acl::User& User() { return *user; }
   const acl::User& User() const { return *user; }
   
-  bool Accept(util::net::TCPListener& server);
+  bool Accept(int socket);
+  bool Dispatch(bool idleTimeout);
+  void Finish();
+  bool IdleExpired() const;
+  long SessionID() const { return sessionID; }
   bool IsFinished() const;
   void SetLoggedIn(bool kicked);
   void SetWaitingPassword(const acl::User& user, bool kickLogin);
@@ -143,6 +150,7 @@ public:
   void SetState(ClientState state);
   
   void Interrupt();
+  void RunSession();
   
   void LogTraffic() const;
   
@@ -0,0 +1,116 @@
+#include <cstring>
+#include "ftp/compression.hpp"
+#include "util/net/error.hpp"
+#include "util/string.hpp"
+#include "fs/path.hpp"
+#include "cfg/get.hpp"
+
+namespace ftp
+{
+
+namespace
+{
+// output is taken from zlib this much at a time
+const size_t outputChunk = 65536;
+
+std::string ErrorMessage(const z_stream& stream, int result)
+{
+  if (stream.msg) return std::string("Compressed data error: ") + stream.msg;
+  return std::string("Compressed data error: ") + zError(result);
+}
+}
+
+Deflater::Deflater(int level)
+{
+  std::memset(&stream, 0, sizeof(stream));
+  int result = deflateInit(&stream, level);
+  if (result != Z_OK) throw util::net::NetworkError(ErrorMessage(stream, result));
+}
+
+Deflater::~Deflater()
+{
+  deflateEnd(&stream);
+}
+
+void Deflater::Deflate(const char* data, size_t len, std::vector<char>& out, int flush)
+{
+  out.clear();
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream.avail_in = len;
+
+  do
+  {
+    size_t used = out.size();
+    out.resize(used + outputChunk);
+    stream.next_out = reinterpret_cast<Bytef*>(out.data() + used);
+    stream.avail_out = outputChunk;
+
+    int result = deflate(&stream, flush);
+    if (result == Z_STREAM_ERROR) throw util::net::NetworkError(ErrorMessage(stream, result));
+    out.resize(used + outputChunk - stream.avail_out);
+  }
+  while (stream.avail_out == 0);
+}
+
+void Deflater::Compress(const char* data, size_t len, std::vector<char>& out)
+{
+  Deflate(data, len, out, Z_NO_FLUSH);
+}
+
+void Deflater::Finish(std::vector<char>& out)
+{
+  Deflate(nullptr, 0, out, Z_FINISH);
+}
+
+Inflater::Inflater() : finished(false)
+{
+  std::memset(&stream, 0, sizeof(stream));
+  int result = inflateInit(&stream);
+  if (result != Z_OK) throw util::net::NetworkError(ErrorMessage(stream, result));
+}
+
+Inflater::~Inflater()
+{
+  inflateEnd(&stream);
+}
+
+void Inflater::Input(const char* data, size_t len)
+{
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream.avail_in = len;
+}
+
+size_t Inflater::Output(char* buffer, size_t size)
+{
+  if (finished || stream.avail_in == 0) return 0;
+
+  stream.next_out = reinterpret_cast<Bytef*>(buffer);
+  stream.avail_out = size;
+
+  int result = inflate(&stream, Z_NO_FLUSH);
+  switch (result)
+  {
+    case Z_STREAM_END :
+      finished = true;
+      break;
+    case Z_OK         :
+    case Z_BUF_ERROR  :
+      break;
+    default           :
+      throw util::net::NetworkError(ErrorMessage(stream, result));
+  }
+
+  return size - stream.avail_out;
+}
+
+int CompressionLevel(const fs::VirtualPath& path)
+{
+  const cfg::Config& config = cfg::Get();
+  if (util::WildcardMatch(config.CompressionExclude(), path.ToString())) return 0;
+
+  auto section = config.SectionMatch(path.ToString());
+  if (section && section->CompressionLevel() >= 0) return section->CompressionLevel();
+  return config.CompressionLevel();
+}
+
+} /* ftp namespace */
@@ -0,0 +1,69 @@
+#ifndef __FTP_COMPRESSION_HPP
+#define __FTP_COMPRESSION_HPP
+
+#include <vector>
+#include <zlib.h>
+
+namespace fs
+{
+class VirtualPath;
+}
+
+namespace ftp
+{
+
+// streaming zlib compression of the data connection for MODE Z, a single
+// stream covers the whole transfer
+class Deflater
+{
+  z_stream stream;
+
+  void Deflate(const char* data, size_t len, std::vector<char>& out, int flush);
+
+public:
+  explicit Deflater(int level);
+  /* Throws NetworkError */
+  ~Deflater();
+
+  Deflater(const Deflater&) = delete;
+  Deflater& operator=(const Deflater&) = delete;
+
+  void Compress(const char* data, size_t len, std::vector<char>& out);
+  /* out is replaced with whatever output is ready, often nothing */
+  void Finish(std::vector<char>& out);
+  /* out is replaced with the remaining output and end of stream */
+  /* Both throw NetworkError */
+};
+
+class Inflater
+{
+  z_stream stream;
+  bool finished;
+
+public:
+  Inflater();
+  /* Throws NetworkError */
+  ~Inflater();
+
+  Inflater(const Inflater&) = delete;
+  Inflater& operator=(const Inflater&) = delete;
+
+  void Input(const char* data, size_t len);
+  /* data must remain valid until Output returns 0 */
+  /* No exceptions */
+
+  size_t Output(char* buffer, size_t size);
+  /* Returns 0 once input is used up or the stream has ended, anything */
+  /* after the end of stream is ignored */
+  /* Throws NetworkError on invalid data */
+
+  bool Finished() const { return finished; }
+};
+
+int CompressionLevel(const fs::VirtualPath& path);
+/* Level for a download, 0 when excluded or when the section disables it */
+/* No exceptions */
+
+} /* ftp namespace */
+
+#endif
@@ -15,9 +15,9 @@ Control::~Control()
 {
 }
 
-void Control::Accept(util::net::TCPListener& listener)
+void Control::Accept(int socket)
 {
-  pimpl->Accept(listener);
+  pimpl->Accept(socket);
 }
 
 std::string Control::NextCommand(const boost::posix_time::time_duration* timeout)
@@ -25,6 +25,16 @@ std::string Control::NextCommand(const boost::posix_time::time_duration* timeout
   return pimpl->NextCommand(timeout);
 }
 
+bool Control::BufferCommand()
+{
+  return pimpl->BufferCommand();
+}
+
+bool Control::CommandPending() const
+{
+  return pimpl->CommandPending();
+}
+
 void Control::PartReply(ReplyCode code, const std::string& message)
 {
   pimpl->PartReply(code, message);
@@ -55,6 +65,11 @@ void Control::Write(const char* buffer, size_t len)
   pimpl->Write(buffer, len);
 }
 
+void Control::Flush()
+{
+  pimpl->Flush();
+}
+
 const util::net::Endpoint& Control::RemoteEndpoint() const
 {
   return pimpl->RemoteEndpoint();
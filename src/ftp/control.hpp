@@ -17,7 +17,6 @@ class time_duration;
 
 namespace util { namespace net
 {
-class TCPListener;
 class TCPSocket;
 class Endpoint;
 }
@@ -42,9 +41,11 @@ public:
   Control();
   ~Control();
   
-  void Accept(util::net::TCPListener& listener);
+  void Accept(int socket);
  
   std::string NextCommand(const boost::posix_time::time_duration* timeout = nullptr);
+  bool BufferCommand();
+  bool CommandPending() const;
   
   ::ftp::Format PartFormat;
   ::ftp::Format Format;
@@ -59,6 +60,9 @@ public:
   void NegotiateTLS();
   
   void Write(const char* buffer, size_t len);
+  /* Buffered until the next final reply or Flush */
+  
+  void Flush();
   
   const util::net::Endpoint& RemoteEndpoint() const;
  
@@ -75,6 +79,7 @@ public:
   std::string WaitForIdnt();
   
   friend class Data;
+  friend class ReactorThread;
 };
 
 } /* ftp namespace */
@@ -24,9 +24,9 @@ ControlImpl::ControlImpl(util::net::TCPSocket** socket) :
   *socket = &this->socket;
 }
 
-void ControlImpl::Accept(util::net::TCPListener& listener)
+void ControlImpl::Accept(int socket)
 {
-  listener.Accept(socket);
+  this->socket.Accept(socket);
 }
 
 void ControlImpl::SendReply(ReplyCode code, bool part, const std::string& message)
@@ -41,6 +41,9 @@ void ControlImpl::SendReply(ReplyCode code, bool part, const std::string& messag
   
   const std::string& str = reply.str();
   Write(str.c_str(), str.length());
+  
+  // the reply to a pipelined command waits to go with the next one
+  if (!part && !socket.LineBuffered()) Flush();
 
   if (lastCode != code && lastCode != CodeNotSet && code != ftp::NoCode)
     throw ProtocolError("Invalid reply code sequence.");
@@ -93,13 +96,41 @@ void ControlImpl::MultiReply(ReplyCode code, bool final, const std::string& mess
   MultiReply(code, final, splitMessages);
 }
 
+void ControlImpl::Flush()
+{
+  if (writeBuffer.empty()) return;
+  
+  // cleared first so a failed write isn't repeated
+  std::string buffer;
+  buffer.swap(writeBuffer);
+  socket.Write(buffer.data(), buffer.length());
+  bytesWrite += buffer.length();
+}
+
 void ControlImpl::NegotiateTLS()
 {
+  // the reply accepting AUTH must go out before the handshake
+  Flush();
   socket.HandshakeTLS(util::net::TLSSocket::Server);
 }
 
+std::string ControlImpl::GetCommand()
+{
+  std::string commandLine;
+  socket.Getline(commandLine, false);
+  bytesRead += commandLine.length();
+  util::TrimRightIf(commandLine, "\n");
+  util::TrimRightIf(commandLine, "\r");
+  StripTelnetChars(commandLine);
+  logs::Debug(commandLine);
+  return commandLine;
+}
+
 std::string ControlImpl::NextCommand(const boost::posix_time::time_duration* timeout)
 {
+  if (socket.LineBuffered()) return GetCommand();
+  Flush();
+
   sigset_t mask;
   sigfillset(&mask);
   sigdelset(&mask, SIGUSR1);
@@ -130,18 +161,7 @@ std::string ControlImpl::NextCommand(const boost::posix_time::time_duration* tim
     }
   }
 
-  if (fds[0].revents & POLLIN)
-  {
-    std::string commandLine;
-    socket.Getline(commandLine, false);
-    bytesRead += commandLine.length();
-    util::TrimRightIf(commandLine, "\n");
-    util::TrimRightIf(commandLine, "\r");
-    StripTelnetChars(commandLine);
-    logs::Debug(commandLine);
-    return commandLine;
-  }
-
+  if (fds[0].revents & POLLIN) return GetCommand();
   if (fds[0].revents & POLLHUP) throw util::net::EndOfStream();
   throw util::net::NetworkError();
 }
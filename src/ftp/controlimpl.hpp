@@ -15,12 +15,6 @@ class time_duration;
 }
 }
 
-namespace util { namespace net
-{
-class TCPListener;
-}
-}
-
 namespace ftp
 {
 
@@ -31,13 +25,19 @@ class ControlImpl
   std::string commandLine;
   bool singleLineReplies;
   std::vector<std::string> deferred;
+  // replies and other output held until the command's final reply, or
+  // longer while pipelined commands are waiting, then sent in one write
+  std::string writeBuffer;
   
   long bytesRead;
   long bytesWrite;
   
+  static const size_t maxWriteBuffer = 65536;
+  
   void SendReply(ReplyCode code, bool part, const std::string& message);
   void MultiReply(ReplyCode code, bool final, const std::vector<std::string>& messages);
   void MultiReply(ReplyCode code, bool final, const std::string& messages);
+  std::string GetCommand();
   
   size_t Read(char* buffer, size_t size)
   { 
@@ -49,9 +49,11 @@ class ControlImpl
 public:  
   ControlImpl(util::net::TCPSocket** socket);
   
-  void Accept(util::net::TCPListener& listener);
+  void Accept(int socket);
  
   std::string NextCommand(const boost::posix_time::time_duration* timeout = nullptr);
+  bool BufferCommand() { return socket.BufferLine(); }
+  bool CommandPending() const { return socket.LineBuffered(); }
   
   void PartReply(ReplyCode code, const std::string& message);
   void Reply(ReplyCode code, const std::string& message);
@@ -65,10 +67,12 @@ public:
   
   void Write(const char* buffer, size_t len)
   {
-    socket.Write(buffer, len);
-    bytesWrite += len;
+    writeBuffer.append(buffer, len);
+    if (writeBuffer.length() >= maxWriteBuffer) Flush();
   }
   
+  void Flush();
+  
   const util::net::Endpoint& RemoteEndpoint() const
   { return socket.RemoteEndpoint(); }
   
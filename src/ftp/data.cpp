@@ -1,7 +1,9 @@
+#include <cassert>
 #include <boost/thread/thread.hpp>
 #include <sys/select.h>
 #include <poll.h>
 #include "ftp/portallocator.hpp"
+#include "ftp/listenerpool.hpp"
 #include "ftp/addrallocator.hpp"
 #include "util/net/interfaces.hpp"
 #include "ftp/data.hpp"
@@ -30,25 +32,44 @@ namespace ftp
 
 Data::Data(Client& client) :
   client(client),
+  listenerPort(0),
   protection(false),
+  tlsClient(false),
   pasvType(PassiveType::None),
   epsvMode(cfg::Get().EPSVFxp() == ::cfg::EPSVFxp::Force ? 
            ::ftp::EPSVMode::Extended : 
            ::ftp::EPSVMode::Normal),
   dataType(::ftp::DataType::Binary),
+  transferMode(::ftp::TransferMode::Stream),
   sscnMode(::ftp::SSCNMode::Server),
   restartOffset(0),
+  rangeEnd(-1),
+  allocateSize(0),
+  socketBuffer(0),
   bytesRead(0),
-  bytesWrite(0)
+  bytesWrite(0),
+  nonBlocking(false)
 {
 }
 
+Data::~Data()
+{
+  CloseListener();
+}
+
+void Data::CloseListener()
+{
+  listener.Close();
+  PortAllocator<PortType::Passive>::Get().Release(listenerPort);
+  listenerPort = 0;
+}
+
 void Data::InitPassive(util::net::Endpoint& ep, PassiveType pasvType)
 {
   using namespace util::net;
 
   socket.Close();
-  listener.Close();
+  CloseListener();
   
   boost::optional<util::net::IPAddress> ip;
   // unable to use alternative pasv_addr if espv mode isn't Full
@@ -86,23 +107,22 @@ void Data::InitPassive(util::net::Endpoint& ep, PassiveType pasvType)
   if (pasvType == PassiveType::PASV && ip->Family() == IPFamily::IPv6)
     FindPartnerIP(*ip, *ip);
 
-  boost::optional<int> firstPort;
-  while (true)
+  if (!ListenerPool::Get().Take(*ip, listener, listenerPort))
+    listenerPort = ListenerPool::Listen(listener, *ip);
+
+  // accepted sockets inherit the buffer sizes, they have to be in place
+  // before the client connects for the window scale to make use of them
+  socketBuffer = acl::SocketBuffer(client.User());
+  if (socketBuffer > 0)
   {
-    int port = PortAllocator<PortType::Passive>::Get().NextPort();
-    if (!firstPort) firstPort.reset(port);
-    else if (port == *firstPort) 
-      throw util::net::NetworkError("All ports exhausted.");
-      
     try
     {
-      listener.Listen(Endpoint(*ip, port));
-      break;
+      listener.SetBufferSize(socketBuffer);
     }
-    catch (const util::net::NetworkSystemError& e)
+    catch (const NetworkError& e)
     {
-      if (e.Errno() != EADDRINUSE)
-        throw;
+      logs::Error("Unable to set data connection socket buffer size: %1%", e.Message());
+      socketBuffer = 0;
     }
   }
 
@@ -114,7 +134,7 @@ void Data::InitActive(const util::net::Endpoint& ep)
 {
   pasvType = PassiveType::None;
   socket.Close();
-  listener.Close();
+  CloseListener();
   
   boost::optional<util::net::IPAddress> localIP;
   std::string firstAddr;
@@ -140,6 +160,7 @@ void Data::InitActive(const util::net::Endpoint& ep)
   
   if (!localIP) localIP = util::net::IPAddress(ep.Family());
   
+  socketBuffer = acl::SocketBuffer(client.User());
   boost::optional<int> firstPort;
   while (true)
   {
@@ -150,7 +171,7 @@ void Data::InitActive(const util::net::Endpoint& ep)
       
     try
     {
-      socket.Connect(ep, util::net::Endpoint(*localIP, localPort));
+      socket.Connect(ep, util::net::Endpoint(*localIP, localPort), socketBuffer);
       break;
     }
     catch (const util::net::NetworkSystemError& e)
@@ -161,8 +182,11 @@ void Data::InitActive(const util::net::Endpoint& ep)
   }
 }
 
-void Data::Open(TransferType transferType)
+void Data::Open(TransferType transferType, int compressionLevel)
 {
+  // the client may wait on replies before connecting
+  client.Control().Flush();
+  
   if (pasvType != PassiveType::None)
   {
     assert(listener.IsListening());
@@ -201,9 +225,29 @@ void Data::Open(TransferType transferType)
         (transferType == TransferType::Upload ||
          transferType == TransferType::Download))
       role = util::net::TLSSocket::Client;  
-    socket.HandshakeTLS(role);
+    tlsClient = role == util::net::TLSSocket::Client;
+    bool resume = tlsClient && socket.RemoteEndpoint().IP() == clientSessionPeer;
+    socket.HandshakeTLS(role, cfg::Get().TlsKernelOffload(), 
+                        resume ? clientSession : util::net::TLSSession());
+    if (socket.IsKernelTLS()) logs::Debug("Data connection using kernel tls offload");
+  }
+  
+  // transfers try each read / write first and only poll when it would
+  // block, instead of polling before every buffer
+  SetNonBlocking(true);
+  
+  if (transferMode == ::ftp::TransferMode::Zlib)
+  {
+    if (transferType == TransferType::Upload)
+      inflater.reset(new Inflater());
+    else
+      deflater.reset(new Deflater(compressionLevel < 0 ? 
+                                  cfg::Get().CompressionLevel() : compressionLevel));
+    compressBuffer.resize(65536);
   }
   
+  nextControlCheck = boost::posix_time::microsec_clock::universal_time() +
+                     boost::posix_time::milliseconds(controlCheckInterval);
   state.Start(transferType);
 }
 
@@ -262,6 +306,8 @@ void Data::HandleControl(int revents)
         client.Control().Reply(ftp::BadCommandSequence, 
                   "Unsupported command during transfer");
       }
+      
+      return;
     }
     
     if (revents & POLLHUP) throw util::net::EndOfStream();
@@ -273,7 +319,7 @@ void Data::HandleControl(int revents)
   }
 }
 
-size_t Data::Read(char* buffer, size_t size)
+void Data::WaitRead()
 {
   int pollTimeout = (socket.Timeout().Seconds() * 1000 ) + 
                     (socket.Timeout().Microseconds() / 1000);
@@ -306,13 +352,115 @@ size_t Data::Read(char* buffer, size_t size)
     }
     
     if (fds[0].revents > 0) HandleControl(fds[0].revents);
-    if (fds[1].revents & POLLIN) return socket.Read(buffer, size);
+    if (fds[1].revents & POLLIN) return;
     if (fds[1].revents & POLLHUP) throw util::net::EndOfStream();
     throw util::net::NetworkError();
   }
 }
 
-void Data::Write(const char* buffer, size_t len)
+void Data::CheckControl()
+{
+  auto now = boost::posix_time::microsec_clock::universal_time();
+  if (now < nextControlCheck) return;
+  nextControlCheck = now + boost::posix_time::milliseconds(controlCheckInterval);
+  
+  if (client.Control().CommandPending())
+  {
+    HandleControl(POLLIN);
+    return;
+  }
+  
+  struct pollfd fd;
+  fd.fd = ControlSocket();
+  fd.events = POLLIN;
+  fd.revents = 0;
+  
+  int n = poll(&fd, 1, 0);
+  if (n < 0)
+  {
+    boost::this_thread::interruption_point();
+    if (errno != EINTR) throw util::net::NetworkSystemError(errno);
+  }
+  else if (n > 0) HandleControl(fd.revents);
+}
+
+void Data::SetNonBlocking(bool nonBlocking)
+{
+  if (this->nonBlocking == nonBlocking || !socket.IsConnected()) return;
+  try
+  {
+    socket.SetBlocking(!nonBlocking);
+    this->nonBlocking = nonBlocking;
+  }
+  catch (const util::net::NetworkError& e)
+  {
+    logs::Error("Unable to change blocking mode of data connection: %1%", e.Message());
+  }
+}
+
+size_t Data::Read(char* buffer, size_t size)
+{
+  if (!inflater) return ReadRaw(buffer, size);
+  
+  while (true)
+  {
+    size_t len = inflater->Output(buffer, size);
+    if (len > 0) return len;
+    
+    try
+    {
+      len = ReadRaw(compressBuffer.data(), compressBuffer.size());
+    }
+    catch (const util::net::EndOfStream&)
+    {
+      // a stream cut short would otherwise be kept as a complete upload
+      if (!inflater->Finished())
+        throw util::net::NetworkError("Compressed data ended early");
+      throw;
+    }
+    inflater->Input(compressBuffer.data(), len);
+  }
+}
+
+size_t Data::ReadRaw(char* buffer, size_t size)
+{
+  CheckControl();
+  if (nonBlocking)
+  {
+    while (true)
+    {
+      size_t len = socket.TryRead(buffer, size);
+      if (len > 0) return len;
+      WaitRead();
+    }
+  }
+  
+  if (!socket.TLSPending()) WaitRead();
+  return socket.Read(buffer, size);
+}
+
+#if defined(__linux__)
+size_t Data::Splice(int pipeFd, size_t count)
+{
+  assert(CanSplice());
+  CheckControl();
+  while (true)
+  {
+    try
+    {
+      return socket.Splice(pipeFd, count);
+    }
+    catch (const util::net::TimeoutError&)
+    {
+      // would block, wait on the data and control sockets
+      if (!nonBlocking) throw;
+      WaitRead();
+    }
+  }
+}
+#endif
+
+void Data::WaitWrite()
 {
   int pollTimeout = (socket.Timeout().Seconds() * 1000 ) + 
                     (socket.Timeout().Microseconds() / 1000);
@@ -345,18 +493,83 @@ void Data::Write(const char* buffer, size_t len)
     }
     
     if (fds[0].revents > 0) HandleControl(fds[0].revents);
-    if (fds[1].revents & POLLOUT)
-    {
-      socket.Write(buffer, len);
-      if (state.Type() == TransferType::List)
-        bytesWrite += len;
-      return;
-    }
+    if (fds[1].revents & POLLOUT) return;
     if (fds[1].revents & POLLHUP) throw util::net::EndOfStream();
     throw util::net::NetworkError();
   }
 }
 
+void Data::Write(const char* buffer, size_t len)
+{
+  if (!deflater)
+  {
+    WriteRaw(buffer, len);
+    return;
+  }
+  
+  deflater->Compress(buffer, len, compressBuffer);
+  if (!compressBuffer.empty()) WriteRaw(compressBuffer.data(), compressBuffer.size());
+}
+
+void Data::Finish()
+{
+  if (!deflater) return;
+  
+  deflater->Finish(compressBuffer);
+  deflater.reset();
+  WriteRaw(compressBuffer.data(), compressBuffer.size());
+}
+
+void Data::WriteRaw(const char* buffer, size_t len)
+{
+  CheckControl();
+  if (nonBlocking)
+  {
+    size_t written = 0;
+    while (written < len)
+    {
+      size_t result = socket.TryWrite(buffer + written, len - written);
+      if (!result) WaitWrite();
+      written += result;
+    }
+  }
+  else
+  {
+    WaitWrite();
+    socket.Write(buffer, len);
+  }
+  
+  if (state.Type() == TransferType::List)
+    bytesWrite += len;
+}
+
+#if defined(__linux__)
+size_t Data::SendFile(int fd, off_t& offset, size_t count)
+{
+  assert(CanSendFile());
+  SetNonBlocking(true);
+  CheckControl();
+  while (true)
+  {
+    try
+    {
+      return socket.SendFile(fd, offset, count);
+    }
+    catch (const util::net::TimeoutError&)
+    {
+      // would block, wait on the data and control sockets
+      if (!nonBlocking) throw;
+      WaitWrite();
+    }
+  }
+}
+#endif
+
+int Data::ControlSocket() const
+{
+  return client.Control().socket->Socket();
+}
+
 void Data::Interrupt()
 {
   socket.Shutdown();
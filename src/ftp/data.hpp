@@ -2,12 +2,15 @@
 #define __FTP_DATA_HPP
 
 #include <memory>
+#include <vector>
 #include <sys/types.h>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include "util/net/tcplistener.hpp"
 #include "util/net/tcpsocket.hpp"
 #include "util/net/endpoint.hpp"
 #include "ftp/writeable.hpp"
 #include "ftp/transferstate.hpp"
+#include "ftp/compression.hpp"
 #include "util/enumstrings.hpp"
 
 namespace acl
@@ -33,6 +36,12 @@ enum class DataType
   Binary
 };
 
+enum class TransferMode
+{
+  Stream,
+  Zlib
+};
+
 enum class PassiveType
 {
   PASV,
@@ -52,24 +61,56 @@ class Data : public Writeable
 {
   Client& client;
   util::net::TCPListener listener;
+  int listenerPort;
   util::net::TCPSocket socket;
   bool protection;
+  // session from the last data connection this end made as the tls client,
+  // with SSCN or CPSV, offered to resume the next one only if it's to the
+  // same peer, with fxp that's often a different site
+  util::net::TLSSession clientSession;
+  util::net::IPAddress clientSessionPeer;
+  bool tlsClient;
   PassiveType pasvType;
   util::net::Endpoint portEndpoint;
   ::ftp::EPSVMode epsvMode;
   ::ftp::DataType dataType;
+  ::ftp::TransferMode transferMode;
   ::ftp::SSCNMode sscnMode;
   off_t restartOffset;
+  off_t rangeEnd;
+  off_t allocateSize;
+  int socketBuffer;
   
   long long bytesRead;
   long long bytesWrite;
   
   TransferState state;
   
+  // MODE Z stream for the current transfer, compressed data is staged in
+  // compressBuffer on its way to or from the socket
+  std::unique_ptr<Deflater> deflater;
+  std::unique_ptr<Inflater> inflater;
+  std::vector<char> compressBuffer;
+  
+  // control connection is checked for ABOR / STAT / QUIT at most this 
+  // often while data is flowing, waits on the data socket always check it
+  static const int controlCheckInterval = 20; // milliseconds
+  boost::posix_time::ptime nextControlCheck;
+  bool nonBlocking;
+  
+  void CloseListener();
   void HandleControl(int revents);
+  void CheckControl();
+  void SetNonBlocking(bool nonBlocking);
+  void WaitRead();
+  void WaitWrite();
+  int ControlSocket() const;
+  size_t ReadRaw(char* buffer, size_t size);
+  void WriteRaw(const char* buffer, size_t len);
 
 public:
   explicit Data(Client& client);
+  ~Data();
   void SetProtection(bool protection) { this->protection = protection; }
   bool Protection() const { return protection; }
 
@@ -82,16 +123,44 @@ public:
   ::ftp::DataType DataType() const { return dataType; }
   void SetDataType(::ftp::DataType dataType) { this->dataType = dataType; }
   
+  ::ftp::TransferMode TransferMode() const { return transferMode; }
+  void SetTransferMode(::ftp::TransferMode transferMode) { this->transferMode = transferMode; }
+  
   void SetRestartOffset(off_t restartOffset) { this->restartOffset = restartOffset; }
   off_t RestartOffset() const { return restartOffset; }
   
+  // last byte of a RANG download, -1 to the end of file
+  void SetRangeEnd(off_t rangeEnd) { this->rangeEnd = rangeEnd; }
+  off_t RangeEnd() const { return rangeEnd; }
+  
+  void SetAllocateSize(off_t allocateSize) { this->allocateSize = allocateSize; }
+  off_t AllocateSize() const { return allocateSize; }
+  
   void InitPassive(util::net::Endpoint& ep, PassiveType pasvType);
   void InitActive(const util::net::Endpoint& ep);
-  void Open(TransferType transferType);
+  void Open(TransferType transferType, int compressionLevel = -1);
+  /* compressionLevel applies to MODE Z downloads and listings, -1 for */
+  /* the configured compression_level */
+  
+  void Finish();
+  /* Ends the MODE Z stream of a completed download or listing, nothing */
+  /* to do otherwise. Throws NetworkError */
   
   void Close()
   {
     restartOffset = 0;
+    rangeEnd = -1;
+    allocateSize = 0;
+    deflater.reset();
+    inflater.reset();
+    SetNonBlocking(false);
+    // tls 1.3 sessions are only resumable once the ticket has arrived
+    if (tlsClient && socket.IsTLS())
+    {
+      clientSession = socket.ResumableSession();
+      clientSessionPeer = socket.RemoteEndpoint().IP();
+    }
+    tlsClient = false;
     socket.Close();
     state.Stop();
   }
@@ -99,6 +168,38 @@ public:
   size_t Read(char* buffer, size_t size);
   void Write(const char* buffer, size_t len);
   
+  int SocketBuffer() const { return socketBuffer; }
+  
+  // zero copy path for binary transfers on plaintext or ktls connections
+  bool CanSendFile() const
+  {
+#if defined(__linux__)
+    return dataType == ::ftp::DataType::Binary && 
+           transferMode == ::ftp::TransferMode::Stream &&
+           (!socket.IsTLS() || socket.IsKernelTLS());
+#else
+    return false;
+#endif
+  }
+  
+#if defined(__linux__)
+  size_t SendFile(int fd, off_t& offset, size_t count);
+#endif
+  
+  bool CanSplice() const
+  {
+#if defined(__linux__)
+    return dataType == ::ftp::DataType::Binary && 
+           transferMode == ::ftp::TransferMode::Stream && !socket.IsTLS();
+#else
+    return false;
+#endif
+  }
+  
+#if defined(__linux__)
+  size_t Splice(int pipeFd, size_t count);
+#endif
+  
   TransferState& State() { return state; }
   const TransferState& State() const { return state; }
   
@@ -110,6 +211,8 @@ public:
   bool IsFXP() const;
   
   bool ProtectionOkay() const;
+  
+  friend class UringEngine;
 };
 
 } /* ftp namespace */
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+#include <vector>
+#include "ftp/listenerpool.hpp"
+#include "ftp/portallocator.hpp"
+#include "util/net/error.hpp"
+#include "util/net/endpoint.hpp"
+#include "cfg/get.hpp"
+#include "logs/logs.hpp"
+#include "util/misc.hpp"
+
+namespace ftp
+{
+
+std::unique_ptr<ListenerPool> ListenerPool::instance;
+boost::once_flag ListenerPool::instanceOnce = BOOST_ONCE_INIT;
+
+ListenerPool::~ListenerPool()
+{
+  Stop(true);
+  Empty();
+}
+
+int ListenerPool::Listen(util::net::TCPListener& listener, const util::net::IPAddress& ip)
+{
+  PortAllocatorImpl& allocator = PortAllocator<PortType::Passive>::Get();
+
+  // ports in use by other processes are skipped, at most once each
+  int attempts = std::max(allocator.NumPorts(), 1);
+  for (int i = 0; i < attempts; ++i)
+  {
+    int port;
+    if (!allocator.Acquire(port)) break;
+
+    try
+    {
+      listener.Listen(util::net::Endpoint(ip, port));
+      return port;
+    }
+    catch (const util::net::NetworkSystemError& e)
+    {
+      allocator.Release(port);
+      if (e.Errno() != EADDRINUSE)
+        throw;
+    }
+  }
+
+  throw util::net::NetworkError("All ports exhausted.");
+}
+
+void ListenerPool::Drain(util::net::TCPListener& listener)
+{
+  // anything that connected while the listener sat in the pool can't be
+  // the client it's about to be handed to
+  listener.SetBlocking(false);
+  try
+  {
+    util::net::Endpoint ep;
+    while (true) close(listener.AcceptSocket(ep));
+  }
+  catch (const util::net::NetworkError&)
+  {
+  }
+  listener.SetBlocking(true);
+}
+
+bool ListenerPool::Take(const util::net::IPAddress& ip, util::net::TCPListener& listener, int& port)
+{
+  if (cfg::Get().PasvListenerPool() <= 0) return false;
+
+  Pooled pooled;
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    if (!started) Start();
+
+    auto& pool = pools[ip.ToString()];
+    cond.notify_one();
+    if (pool.empty()) return false;
+
+    pooled = std::move(pool.front());
+    pool.pop_front();
+  }
+
+  try
+  {
+    Drain(*pooled.listener);
+  }
+  catch (const util::net::NetworkError&)
+  {
+    PortAllocator<PortType::Passive>::Get().Release(pooled.port);
+    throw;
+  }
+
+  listener.Swap(*pooled.listener);
+  port = pooled.port;
+  return true;
+}
+
+void ListenerPool::Flush()
+{
+  boost::lock_guard<boost::mutex> lock(mutex);
+  flush = true;
+  cond.notify_one();
+}
+
+void ListenerPool::Empty()
+{
+  for (auto& kv : pools)
+  {
+    for (auto& pooled : kv.second)
+    {
+      pooled.listener->Close();
+      PortAllocator<PortType::Passive>::Get().Release(pooled.port);
+    }
+    kv.second.clear();
+  }
+}
+
+void ListenerPool::Fill(size_t size)
+{
+  boost::unique_lock<boost::mutex> lock(mutex);
+  
+  // addresses may be added while unlocked, iterate over a copy
+  std::vector<std::string> addresses;
+  for (const auto& kv : pools) addresses.push_back(kv.first);
+  
+  for (const auto& address : addresses)
+  {
+    util::net::IPAddress ip(address);
+    auto& pool = pools[address];
+    while (pool.size() < size && !flush)
+    {
+      lock.unlock();
+
+      Pooled pooled;
+      pooled.listener.reset(new util::net::TCPListener());
+      try
+      {
+        pooled.port = Listen(*pooled.listener, ip);
+      }
+      catch (const util::net::NetworkError& e)
+      {
+        logs::Error("Unable to fill passive listener pool for %1%: %2%", address, e.Message());
+        boost::this_thread::sleep(boost::posix_time::seconds(5));
+        lock.lock();
+        break;
+      }
+
+      lock.lock();
+      pool.emplace_back(std::move(pooled));
+    }
+  }
+}
+
+void ListenerPool::Run()
+{
+  util::SetProcessTitle("PASV POOL");
+
+  while (true)
+  {
+    // pick up changes to the pool size
+    cfg::UpdateLocal();
+    size_t size = std::max(cfg::Get().PasvListenerPool(), 0);
+
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      if (flush || size == 0)
+      {
+        Empty();
+        flush = false;
+      }
+    }
+
+    Fill(size);
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (!flush)
+    {
+      bool full = true;
+      for (const auto& kv : pools)
+      {
+        if (kv.second.size() < size) full = false;
+      }
+      if (!full) break;
+      cond.wait(lock);
+    }
+  }
+}
+
+} /* ftp namespace */
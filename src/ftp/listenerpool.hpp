@@ -0,0 +1,73 @@
+#ifndef __FTP_LISTENERPOOL_HPP
+#define __FTP_LISTENERPOOL_HPP
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <boost/thread/once.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "util/thread.hpp"
+#include "util/net/tcplistener.hpp"
+#include "util/net/ipaddress.hpp"
+
+namespace ftp
+{
+
+// passive listeners bound and listening ahead of time for each local address
+// handed out passive connections, refilled in the background as they're
+// taken so PASV / EPSV needn't search for a free port
+class ListenerPool : public util::Thread
+{
+  struct Pooled
+  {
+    std::unique_ptr<util::net::TCPListener> listener;
+    int port;
+  };
+
+  boost::mutex mutex;
+  boost::condition_variable cond;
+  std::unordered_map<std::string, std::deque<Pooled>> pools;
+  bool flush;
+
+  static std::unique_ptr<ListenerPool> instance;
+  static boost::once_flag instanceOnce;
+
+  static void CreateInstance() { instance.reset(new ListenerPool()); }
+
+  ListenerPool() : flush(false) { }
+
+  void Run();
+  void Fill(size_t size);
+  void Empty();
+
+  static void Drain(util::net::TCPListener& listener);
+
+public:
+  ~ListenerPool();
+
+  bool Take(const util::net::IPAddress& ip, util::net::TCPListener& listener, int& port);
+  /* Returns false when the pool is disabled or there's no listener ready */
+  /* for ip yet, port is set to the allocated port to release on close */
+  /* Throws NetworkError */
+
+  void Flush();
+  /* Pooled listeners are closed and replaced, for when ports change */
+  /* No exceptions */
+
+  static int Listen(util::net::TCPListener& listener, const util::net::IPAddress& ip);
+  /* Binds to the next free passive port, returns the allocated port */
+  /* to release when the listener is closed */
+  /* Throws NetworkError */
+
+  static ListenerPool& Get()
+  {
+    boost::call_once(&CreateInstance, instanceOnce);
+    return *instance;
+  }
+};
+
+} /* ftp namespace */
+
+#endif
@@ -8,37 +8,39 @@ namespace ftp
 
 CounterResult LoginCounter::Start(acl::UserID uid, int limit, bool kickLogin, bool exempt)
 {
-  std::lock_guard<std::mutex> lock(mutex);
-  int& count = personal[uid];
+  Shard& shard = ShardFor(uid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  int& count = shard.personal[uid];
   if (limit != -1 && count - kickLogin >= limit)
   {
     return CounterResult::PersonalFail;
   }
   int maxUsers = cfg::Config::MaxOnline().Users();
   if (exempt) maxUsers += cfg::Config::MaxOnline().ExemptUsers();
-  if (global - kickLogin > maxUsers)
+  if (global.load(std::memory_order_relaxed) - kickLogin > maxUsers)
   {
 //    return CounterResult::GlobalFail;
   }
   ++count;
-  ++global;
+  global.fetch_add(1, std::memory_order_relaxed);
   return CounterResult::Okay;
 }
 
 void LoginCounter::Stop(acl::UserID uid)
 {
-  std::lock_guard<std::mutex> lock(mutex);
-  int& count = personal[uid];
-  assert(count > 0);
-  --count;
-  assert(global > 0);
-  --global;
+  Shard& shard = ShardFor(uid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.personal.find(uid);
+  assert(it != shard.personal.end() && it->second > 0);
+  if (--it->second == 0) shard.personal.erase(it);
+  int previous = global.fetch_sub(1, std::memory_order_relaxed);
+  assert(previous > 0);
+  (void) previous;
 }
 
 int LoginCounter::GlobalCount() const
 {
-  std::lock_guard<std::mutex> lock(mutex);
-  return global;
+  return global.load(std::memory_order_relaxed);
 }
 
 } /* ftp namespace */
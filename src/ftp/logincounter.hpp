@@ -1,6 +1,7 @@
 #ifndef __LOGINCOUNTER_HPP
 #define __LOGINCOUNTER_HPP
 
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
 #include <functional>
@@ -13,9 +14,20 @@ enum class CounterResult : int;
 
 class LoginCounter
 {
-  mutable std::mutex mutex;
-  int global;
-  std::unordered_map<acl::UserID, int> personal;
+  // users are spread across shards so logins by different users rarely
+  // contend, the global count is kept apart and never locked
+  struct alignas(64) Shard
+  {
+    std::mutex mutex;
+    std::unordered_map<acl::UserID, int> personal;
+  };
+  
+  constexpr static size_t numShards = 16;
+  
+  std::atomic<int> global;
+  Shard shards[numShards];
+
+  Shard& ShardFor(acl::UserID uid) { return shards[static_cast<size_t>(uid) % numShards]; }
 
   LoginCounter() :
     global(0)
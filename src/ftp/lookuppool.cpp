@@ -0,0 +1,85 @@
+#include <boost/bind.hpp>
+#include "ftp/lookuppool.hpp"
+#include "logs/logs.hpp"
+
+namespace ftp
+{
+
+std::unique_ptr<LookupPool> LookupPool::hostnameInstance;
+std::unique_ptr<LookupPool> LookupPool::identInstance;
+boost::once_flag LookupPool::instanceOnce = BOOST_ONCE_INIT;
+
+LookupPool::~LookupPool()
+{
+  Stop();
+}
+
+bool LookupPool::Queue(const std::function<void()>& job)
+{
+  boost::lock_guard<boost::mutex> lock(mutex);
+  if (stopping || jobs.size() >= maxQueued) return false;
+  
+  // started on first use so a server without lookups enabled has none
+  while (static_cast<int>(threads.size()) < numThreads)
+  {
+    try
+    {
+      threads.emplace_back(new boost::thread(boost::bind(&LookupPool::Run, this)));
+    }
+    catch (const boost::thread_resource_error& e)
+    {
+      logs::Error("Unable to start %1% lookup thread: %2%", name, e.what());
+      if (threads.empty()) return false;
+      break;
+    }
+  }
+  
+  jobs.push_back(job);
+  jobReady.notify_one();
+  return true;
+}
+
+void LookupPool::Stop()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    if (threads.empty()) return;
+    logs::Debug("Stopping %1% lookup threads..", name);
+    stopping = true;
+    jobs.clear();
+  }
+  
+  jobReady.notify_all();
+  for (auto& thread : threads)
+  {
+    thread->interrupt();
+    thread->join();
+  }
+  threads.clear();
+}
+
+void LookupPool::Run()
+{
+  while (true)
+  {
+    std::function<void()> job;
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      while (jobs.empty() && !stopping) jobReady.wait(lock);
+      if (stopping) return;
+      job = std::move(jobs.front());
+      jobs.pop_front();
+    }
+    
+    try
+    {
+      job();
+    }
+    catch (const boost::thread_interrupted&)
+    {
+      return;
+    }
+  }
+}
+
+} /* ftp namespace */
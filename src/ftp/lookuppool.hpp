@@ -0,0 +1,74 @@
+#ifndef __FTP_LOOKUPPOOL_HPP
+#define __FTP_LOOKUPPOOL_HPP
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/once.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace ftp
+{
+
+// small fixed set of threads lookups for new connections are run on, jobs
+// beyond the queue limit are refused rather than growing the thread count
+// during a connection flood. reverse dns and ident each have their own so
+// idents that time out can't hold up hostnames needed for the address check
+class LookupPool
+{
+  std::string name;
+  boost::mutex mutex;
+  boost::condition_variable jobReady;
+  std::deque<std::function<void()>> jobs;
+  std::vector<std::unique_ptr<boost::thread>> threads;
+  bool stopping;
+
+  static const int numThreads = 8;
+  static const size_t maxQueued = 1024;
+
+  static std::unique_ptr<LookupPool> hostnameInstance;
+  static std::unique_ptr<LookupPool> identInstance;
+  static boost::once_flag instanceOnce;
+
+  static void CreateInstances()
+  {
+    hostnameInstance.reset(new LookupPool("hostname"));
+    identInstance.reset(new LookupPool("ident"));
+  }
+
+  LookupPool(const std::string& name) : name(name), stopping(false) { }
+
+  void Run();
+
+public:
+  ~LookupPool();
+
+  bool Queue(const std::function<void()>& job);
+  /* Returns false when the queue is full, the pool is stopping or no */
+  /* thread could be started, job is then never run */
+  /* No exceptions */
+
+  void Stop();
+  /* Discards queued jobs and waits for those running to finish */
+  /* No exceptions */
+
+  static LookupPool& Hostname()
+  {
+    boost::call_once(&CreateInstances, instanceOnce);
+    return *hostnameInstance;
+  }
+  
+  static LookupPool& Ident()
+  {
+    boost::call_once(&CreateInstances, instanceOnce);
+    return *identInstance;
+  }
+};
+
+} /* ftp namespace */
+
+#endif
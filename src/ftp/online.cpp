@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring>
 #include <sstream>
 #include <fstream>
@@ -5,6 +6,7 @@
 #include "ftp/client.hpp"
 #include "acl/user.hpp"
 #include "util/error.hpp"
+#include "logs/logs.hpp"
 #include "main.hpp"
 
 using namespace boost::interprocess;
@@ -12,18 +14,6 @@ using namespace boost::interprocess;
 namespace ftp
 {
 
-namespace
-{
-long ThreadIdToLong(const boost::thread::id& tid)
-{
-  std::stringstream ss;
-  ss << tid;
-  long ltid;
-  ss >> std::hex >> ltid;
-  return ltid;
-}
-}
-
 std::unique_ptr<OnlineWriter> OnlineWriter::instance;
 boost::posix_time::milliseconds OnlineTransferUpdater::interval(10);
 
@@ -34,6 +24,16 @@ OnlineXfer::OnlineXfer(stats::Direction direction, const boost::posix_time::ptim
 {
 }
 
+OnlineClient::OnlineClient() :
+  uid(-1),
+  command{0},
+  workDir{0},
+  ident{0},
+  ip{0},
+  hostname{0}
+{
+}
+
 OnlineClient::OnlineClient(
       acl::UserID uid, const std::string& ident, 
       const std::string& ip, const std::string& hostname,
@@ -48,13 +48,28 @@ OnlineClient::OnlineClient(
   strncpy(this->workDir, workDir.c_str(), sizeof(this->workDir));
 }
 
-OnlineData::OnlineData(boost::interprocess::managed_shared_memory& segment, int maxClients) :
-  clients(maxClients, std::hash<long>(), std::equal_to<long>(), segment.get_allocator<ShmOnlineMap::mapped_type>())
+namespace
+{
+
+// only the owning session writes a slot, freeing it included, so the
+// sequence needs no atomic increment, just ordering against the client data
+void BeginWrite(OnlineSlot& slot)
+{
+  slot.sequence.store(slot.sequence.load(std::memory_order_relaxed) + 1, 
+                      std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void EndWrite(OnlineSlot& slot)
 {
+  slot.sequence.store(slot.sequence.load(std::memory_order_relaxed) + 1, 
+                      std::memory_order_release);
+}
+
 }
 
 OnlineWriter::OnlineWriter(const std::string& id, int maxClients) :
-  id(id), data(nullptr)
+  id(id), slots(nullptr), numSlots(0)
 {
   OpenSharedMemory(maxClients);
 }
@@ -63,13 +78,13 @@ void OnlineWriter::OpenSharedMemory(int maxClients)
 {  
   try
   {
-    segment.reset(new managed_shared_memory(open_or_create, id.c_str(), clientSize * (maxClients + 1)));
+    numSlots = std::max(maxClients, 1);
+    segment.reset(new managed_shared_memory(open_or_create, id.c_str(), 
+                  sizeof(OnlineSlot) * numSlots + segmentOverhead));
 
-    segment->construct<OnlineData>("online")(*segment, maxClients);
-    data = segment->find<OnlineData>("online").first;
-    if (!data) throw util::SystemError(ENOMEM);
-    scoped_lock<interprocess_mutex> lock(data->mutex);
-    data->clients.clear();
+    segment->destroy<OnlineSlot>("online");
+    slots = segment->construct<OnlineSlot>("online")[numSlots]();
+    if (!slots) throw util::SystemError(ENOMEM);
   }
   catch (const interprocess_exception& e)
   {
@@ -83,119 +98,113 @@ OnlineWriter::~OnlineWriter()
   shared_memory_object::remove(id.c_str());
 }
 
-void OnlineWriter::LoggedIn(long tid, Client& client, const std::string& workDir)
-{
-  scoped_lock<interprocess_mutex> lock(data->mutex);
-  data->clients.insert(std::make_pair(tid, OnlineClient(client.User().ID(), client.Ident(), 
-              client.IP(), client.Hostname(), workDir)));  
-}
-
-void OnlineWriter::LoggedIn(const boost::thread::id& tid, Client& client, const std::string& workDir)
+OnlineSlot* OnlineWriter::Find(long sessionID) const
 {
-  LoggedIn(ThreadIdToLong(tid), client, workDir);
-}
-
-void OnlineWriter::LoggedOut(long tid)
-{
-  scoped_lock<interprocess_mutex> lock(data->mutex);
-  data->clients.erase(tid);
-}
-
-void OnlineWriter::LoggedOut(const boost::thread::id& tid)
-{
-  LoggedOut(ThreadIdToLong(tid));
+  // sessions start looking from their own position, so unless the
+  // table is crowded the first slot is the one
+  for (size_t i = 0; i < numSlots; ++i)
+  {
+    OnlineSlot& slot = slots[(sessionID + i) % numSlots];
+    if (slot.sessionID.load(std::memory_order_relaxed) == sessionID) return &slot;
+  }
+  return nullptr;
 }
 
-void OnlineWriter::Command(long tid, const std::string& command)
+void OnlineWriter::LoggedIn(long sessionID, Client& client, const std::string& workDir)
 {
-  scoped_lock<interprocess_mutex> lock(data->mutex);
-  auto it = data->clients.find(tid);
-  verify(it != data->clients.end());
-  strncpy(it->second.command, command.c_str(), sizeof(it->second.command));
+  OnlineSlot* slot = Find(sessionID);
+  for (size_t i = 0; i < numSlots && !slot; ++i)
+  {
+    OnlineSlot& free = slots[(sessionID + i) % numSlots];
+    long expected = 0;
+    if (free.sessionID.compare_exchange_strong(expected, sessionID)) slot = &free;
+  }
+  
+  if (!slot)
+  {
+    logs::Error("Online table full, session %1% not shown in who", sessionID);
+    return;
+  }
+  
+  OnlineClient online(client.User().ID(), client.Ident(), client.IP(), 
+                      client.Hostname(), workDir);
+  BeginWrite(*slot);
+  slot->client = online;
+  slot->used = true;
+  EndWrite(*slot);
 }
 
-void OnlineWriter::Command(const boost::thread::id& tid, const std::string& command)
+void OnlineWriter::LoggedOut(long sessionID)
 {
-  Command(ThreadIdToLong(tid), command);
+  OnlineSlot* slot = Find(sessionID);
+  if (!slot) return;
+  
+  BeginWrite(*slot);
+  slot->used = false;
+  slot->client.xfer = boost::none;
+  EndWrite(*slot);
+  slot->sessionID.store(0, std::memory_order_release);
 }
 
-void OnlineWriter::Idle(long tid)
+void OnlineWriter::Command(long sessionID, const std::string& command)
 {
-  scoped_lock<interprocess_mutex> lock(data->mutex);
-  auto it = data->clients.find(tid);
-  verify(it != data->clients.end());
-  it->second.command[0] = '\0';
-  it->second.lastCommand = boost::posix_time::second_clock::local_time();
+  OnlineSlot* slot = Find(sessionID);
+  if (!slot) return;
+  
+  BeginWrite(*slot);
+  strncpy(slot->client.command, command.c_str(), sizeof(slot->client.command));
+  EndWrite(*slot);
 }
 
-void OnlineWriter::Idle(const boost::thread::id& tid)
+void OnlineWriter::Idle(long sessionID)
 {
-  Idle(ThreadIdToLong(tid));
+  OnlineSlot* slot = Find(sessionID);
+  if (!slot) return;
+  
+  auto now = boost::posix_time::second_clock::local_time();
+  BeginWrite(*slot);
+  slot->client.command[0] = '\0';
+  slot->client.lastCommand = now;
+  EndWrite(*slot);
 }
 
-void OnlineWriter::StartTransfer(long tid, stats::Direction direction, 
+void OnlineWriter::StartTransfer(long sessionID, stats::Direction direction, 
                                  const boost::posix_time::ptime& start)
 {
-  scoped_lock<interprocess_mutex> lock(data->mutex);
-  auto it = data->clients.find(tid);
-  verify(it != data->clients.end());
-  it->second.xfer.reset(OnlineXfer(direction, start));
-}
-
-void OnlineWriter::TransferUpdate(long tid, long long bytes)
-{
-  scoped_lock<interprocess_mutex> lock(data->mutex);
-  auto it = data->clients.find(tid);
-  verify(it != data->clients.end());
-  assert(it->second.xfer);
-  it->second.xfer->bytes = bytes;
-}
-
-void OnlineWriter::StopTransfer(long tid)
-{
-  scoped_lock<interprocess_mutex> lock(data->mutex);
-  auto it = data->clients.find(tid);
-  verify(it != data->clients.end());
-  assert(it->second.xfer);
-  it->second.xfer = boost::none;
-}
-
-OnlineReaderIterator::OnlineReaderIterator(const OnlineReader* const reader) :
-  reader(reader)
-{
-  if (reader && reader->data) iter.reset(reader->data->clients.begin());
-}
-
-OnlineReaderIterator::OnlineReaderIterator(const OnlineReader* const reader, bool /* end */) :
-  reader(reader)
-{
-  if (reader && reader->data) iter.reset(reader->data->clients.end());
+  OnlineSlot* slot = Find(sessionID);
+  if (!slot) return;
+  
+  slot->bytes.store(0, std::memory_order_relaxed);
+  BeginWrite(*slot);
+  slot->client.xfer.reset(OnlineXfer(direction, start));
+  EndWrite(*slot);
 }
 
-OnlineReaderIterator& OnlineReaderIterator::operator++()
+void OnlineWriter::TransferUpdate(long sessionID, long long bytes)
 {
-  client = boost::none;
-  verify(iter && reader && reader->locked);
-  ++(*iter);
-  return *this;
+  OnlineSlot* slot = Find(sessionID);
+  if (slot) slot->bytes.store(bytes, std::memory_order_relaxed);
 }
 
-OnlineReaderIterator OnlineReaderIterator::operator++(int)
+void OnlineWriter::StopTransfer(long sessionID)
 {
-  client = boost::none;
-  verify(iter && reader && reader->locked);
-  OnlineReaderIterator temp(*this);
-  ++(*iter);
-  return temp;
+  OnlineSlot* slot = Find(sessionID);
+  if (!slot) return;
+  
+  BeginWrite(*slot);
+  slot->client.xfer = boost::none;
+  EndWrite(*slot);
 }
 
 OnlineReader::OnlineReader(const std::string& id) :    
-  data(nullptr), locked(false)
+  slots(nullptr), numSlots(0)
 {
   try
   {
     segment.reset(new managed_shared_memory(open_only, id.c_str()));
-    data = segment->find<OnlineData>("online").first;
+    auto found = segment->find<OnlineSlot>("online");
+    slots = found.first;
+    numSlots = slots ? found.second : 0;
   }
   catch (const boost::interprocess::interprocess_exception& e)
   {
@@ -209,53 +218,66 @@ OnlineReader::~OnlineReader()
   shared_memory_object::remove(id.c_str());
 }
 
-OnlineReaderIterator OnlineReader::begin() const
+bool OnlineReader::Read(const OnlineSlot& slot, OnlineClient& client) const
 {
-  verify(locked);
-  return OnlineReaderIterator(this);
-}
-
-OnlineReaderIterator OnlineReader::end() const
-{
-  verify(locked);
-  return OnlineReaderIterator(this, true);
-}
-
-OnlineReader::size_type OnlineReader::size() const
-{
-  if (!data) return 0;
-  if (locked) return data->clients.size();
-  else
+  // a slot left mid write by a server that died is skipped rather than
+  // waited on forever
+  for (int attempt = 0; attempt < 1000; ++attempt)
   {
-    scoped_lock<interprocess_mutex> lock(data->mutex);
-    return data->clients.size();
+    unsigned before = slot.sequence.load(std::memory_order_acquire);
+    if (before & 1)
+    {
+      boost::this_thread::yield();
+      continue;
+    }
+    
+    bool used = slot.used;
+    client = slot.client;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != before) continue;
+    
+    if (!used) return false;
+    if (client.xfer) client.xfer->bytes = slot.bytes.load(std::memory_order_relaxed);
+    return true;
   }
+  
+  return false;
 }
 
-void OnlineReader::Lock() const
+void OnlineReader::Snapshot(std::vector<OnlineClient>& clients) const
 {
-  locked = true;
-  if (data) data->mutex.lock();
+  OnlineClient client;
+  for (size_t i = 0; i < numSlots; ++i)
+  {
+    if (slots[i].sessionID.load(std::memory_order_acquire) == 0) continue;
+    if (Read(slots[i], client)) clients.push_back(client);
+  }
 }
 
-void OnlineReader::Unlock() const
+size_t OnlineReader::size() const
 {
-  locked = false;
-  if (data) data->mutex.unlock();
+  size_t count = 0;
+  OnlineClient client;
+  for (size_t i = 0; i < numSlots; ++i)
+  {
+    if (slots[i].sessionID.load(std::memory_order_acquire) == 0) continue;
+    if (Read(slots[i], client)) ++count;
+  }
+  return count;
 }
 
 OnlineTransferUpdater::OnlineTransferUpdater(
-        const boost::thread::id& tid, stats::Direction direction,
+        long sessionID, stats::Direction direction,
         const boost::posix_time::ptime& start) :
-  tid(ThreadIdToLong(tid)),
+  sessionID(sessionID),
   nextUpdate(start)
 {
-  OnlineWriter::Get().StartTransfer(this->tid, direction, start);
+  OnlineWriter::Get().StartTransfer(sessionID, direction, start);
 }
 
 OnlineTransferUpdater::~OnlineTransferUpdater()
 {
-  OnlineWriter::Get().StopTransfer(tid);
+  OnlineWriter::Get().StopTransfer(sessionID);
 }
 
 std::string SharedMemoryID(pid_t pid)
@@ -1,14 +1,11 @@
-#include <iterator>
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
-#include <boost/interprocess/segment_manager.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
 #include <boost/interprocess/managed_shared_memory.hpp>
-#include <boost/interprocess/containers/map.hpp>
-#include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/optional.hpp>
-#include <boost/unordered_map.hpp>
 #include <limits.h>
 #if defined(__FreeBSD__)
 #include <sys/param.h>
@@ -48,6 +45,7 @@ struct OnlineClient
 	
   boost::optional<OnlineXfer> xfer;
 
+  OnlineClient();
 	OnlineClient(acl::UserID uid, const std::string& ident, 
                const std::string& ip, const std::string& hostname,
                const std::string& workDir);
@@ -55,17 +53,20 @@ struct OnlineClient
   bool IsIdle() const { return command[0] == '\0'; }
 };
 
-typedef boost::interprocess::managed_shared_memory::segment_manager SegmentManager;
-typedef boost::interprocess::allocator<std::pair<const long, OnlineClient>, 
-                                       SegmentManager> ShmOnlineMapAlloc;
-typedef boost::unordered_map<long, OnlineClient, std::hash<long>, std::equal_to<long>, ShmOnlineMapAlloc> ShmOnlineMap;
-
-struct OnlineData
+// one per session in a fixed array in the shared memory segment, written
+// only by the thread of the session that claimed it so writers never wait
+// on each other. readers copy the client out and retry if the sequence was
+// odd or changed while they did. transfer progress is a separate counter
+// so the frequent updates don't disturb readers
+struct OnlineSlot
 {
-  ShmOnlineMap clients;
-  boost::interprocess::interprocess_mutex mutex;
+  std::atomic<long> sessionID; // 0 when free
+  std::atomic<unsigned> sequence;
+  std::atomic<long long> bytes;
+  bool used;
+  OnlineClient client;
   
-  OnlineData(boost::interprocess::managed_shared_memory& segment, int maxClients);
+  OnlineSlot() : sessionID(0), sequence(0), bytes(0), used(false) { }
 };
 
 class Client;
@@ -75,31 +76,29 @@ class OnlineWriter
 {
   std::string id;
   std::unique_ptr<boost::interprocess::managed_shared_memory> segment;
-  OnlineData* data;
+  OnlineSlot* slots;
+  size_t numSlots;
 
 	static std::unique_ptr<OnlineWriter> instance;
-  constexpr static float clientOverhead = 0.02;
-  constexpr static size_t clientSize = sizeof(OnlineClient) * (1 + clientOverhead);
+  // segment manager bookkeeping on top of the slots
+  constexpr static size_t segmentOverhead = 65536;
 
   OnlineWriter(const std::string& id, int maxClients);
   void OpenSharedMemory(int maxClients);
+  
+  OnlineSlot* Find(long sessionID) const;
 
-  void LoggedIn(long tid, Client& client, const std::string& workDir);
-	void LoggedOut(long tid);
-	void Command(long tid, const std::string& command);
-	void Idle(long tid);
-
-	void StartTransfer(long tid, stats::Direction direction, const boost::posix_time::ptime& start);
-	void TransferUpdate(long tid, long long bytes);
-	void StopTransfer(long tid);
+	void StartTransfer(long sessionID, stats::Direction direction, const boost::posix_time::ptime& start);
+	void TransferUpdate(long sessionID, long long bytes);
+	void StopTransfer(long sessionID);
   
 public:
   ~OnlineWriter();
   
-  void LoggedIn(const boost::thread::id& tid, Client& client, const std::string& workDir);
-	void LoggedOut(const boost::thread::id& tid);
-	void Command(const boost::thread::id& tid, const std::string& command);
-	void Idle(const boost::thread::id& tid);
+  void LoggedIn(long sessionID, Client& client, const std::string& workDir);
+	void LoggedOut(long sessionID);
+	void Command(long sessionID, const std::string& command);
+	void Idle(long sessionID);
   
 	static void Initialise(const std::string& id, int maxClients)
   {
@@ -116,114 +115,35 @@ public:
   friend class OnlineTransferUpdater;
 };
 
-class OnlineReaderLock;
-class OnlineReader;
-
-class OnlineReaderIterator : public std::iterator<std::forward_iterator_tag, OnlineClient>
-{
-  const OnlineReader* const reader;
-  boost::optional<ShmOnlineMap::iterator> iter;
-  mutable boost::optional<OnlineClient> client;
-    
-  OnlineReaderIterator(const OnlineReader* const reader, bool end); 
-  OnlineReaderIterator(const OnlineReader* const reader);
-  
-public:
-    
-  OnlineReaderIterator& operator++();
-  OnlineReaderIterator operator++(int);
-  
-  bool operator==(const OnlineReaderIterator& rhs) const
-  {
-    if (!iter && !rhs.iter) return true;
-    verify(iter);
-    return *iter == *rhs.iter;
-  }
-  
-  bool operator!=(const OnlineReaderIterator& rhs) const
-  {
-    return !operator==(rhs);
-  }
-  
-  const OnlineClient& operator*() const
-  {
-    if (!client) client.reset((*iter)->second);
-    return *client;
-  }
-
-  const OnlineClient* operator->() const
-  {
-    if (!client) client.reset((*iter)->second);
-    return &*client;
-  }
-  
-  friend class OnlineReader;
-};
-
 class OnlineReader
 {
   std::string id;
   std::unique_ptr<boost::interprocess::managed_shared_memory> segment;
-  OnlineData* data;
-  mutable bool locked;
+  const OnlineSlot* slots;
+  size_t numSlots;
   
-  void Lock() const;
-  void Unlock() const;
+  bool Read(const OnlineSlot& slot, OnlineClient& client) const;
   
 public:
-  typedef OnlineReaderIterator const_iterator;
-  typedef OnlineClient value_type;
-  typedef ShmOnlineMap::size_type size_type;
-
   OnlineReader(const std::string& id);
   ~OnlineReader();
   
-  OnlineReaderIterator begin() const;
-  OnlineReaderIterator end() const;
-  
-  size_type size() const;
-
-  friend class OnlineReaderLock;
-  friend class OnlineReaderIterator;
-};
-
-class OnlineReaderLock
-{
-  const OnlineReader& reader;
-  bool released;
+  void Snapshot(std::vector<OnlineClient>& clients) const;
+  /* Appends a copy of each online client, never blocks the server */
+  /* No exceptions */
   
-public:
-  OnlineReaderLock(const OnlineReader& reader) :
-    reader(reader), released(false)
-  {
-    reader.Lock();
-  }
-  
-  ~OnlineReaderLock()
-  {
-    if (!released)
-    {
-      reader.Unlock();
-    }
-  }
-  
-  void Release()
-  {
-    verify(!released);
-    reader.Unlock();
-    released = true;
-  }
+  size_t size() const;
 };
 
 class OnlineTransferUpdater
 {
-  long tid;
+  long sessionID;
   boost::posix_time::ptime nextUpdate;
   
   static boost::posix_time::milliseconds interval;
   
 public:
-  OnlineTransferUpdater(const boost::thread::id& tid, stats::Direction direction,
+  OnlineTransferUpdater(long sessionID, stats::Direction direction,
                         const boost::posix_time::ptime& start);
   
   ~OnlineTransferUpdater();
@@ -233,7 +153,7 @@ public:
     auto now = boost::posix_time::microsec_clock::local_time();
     if (now >= nextUpdate)
     {
-      OnlineWriter::Get().TransferUpdate(tid, bytes);
+      OnlineWriter::Get().TransferUpdate(sessionID, bytes);
       nextUpdate = now + interval;
     }
   }
@@ -5,9 +5,11 @@
 #include <cassert>
 #include <vector>
 #include <mutex>
+#include <cstdint>
 #include <boost/thread/once.hpp>
 #include "util/net/endpoint.hpp"
 #include "cfg/get.hpp"
+#include "ftp/listenerpool.hpp"
 
 namespace ftp
 {
@@ -27,8 +29,34 @@ class PortAllocatorImpl
   cfg::Ports ports;
   std::vector<cfg::PortRange>::const_iterator it;
   int nextPort;
+  int numPorts;
+  // one bit per port for those handed out by Acquire and not yet released,
+  // kept by port number so it survives the ranges changing
+  std::vector<uint64_t> inUse;
   
-  PortAllocatorImpl() : nextPort(0) { }
+  PortAllocatorImpl() : nextPort(0), numPorts(0), inUse(65536 / 64, 0) { }
+  
+  void SetInUse(int port, bool used)
+  {
+    uint64_t bit = static_cast<uint64_t>(1) << (port % 64);
+    if (used) inUse[port / 64] |= bit;
+    else inUse[port / 64] &= ~bit;
+  }
+  
+  int FindFree(int from, int to) const
+  {
+    // a word at a time, skipping past up to 64 used ports per step
+    for (int port = from; port <= to; port = (port / 64 + 1) * 64)
+    {
+      uint64_t used = inUse[port / 64] | ((static_cast<uint64_t>(1) << (port % 64)) - 1);
+      if (used != ~static_cast<uint64_t>(0))
+      {
+        int free = (port / 64) * 64 + __builtin_ctzll(~used);
+        return free <= to ? free : -1;
+      }
+    }
+    return -1;
+  }
   
 public:
   void SetPorts(const cfg::Ports& ports)
@@ -36,6 +64,64 @@ public:
     std::lock_guard<std::mutex> lock(mutex);
     this->ports = ports;
     it = this->ports.Ranges().begin();
+    nextPort = 0;
+    numPorts = 0;
+    for (const auto& range : this->ports.Ranges())
+      numPorts += range.To() - range.From() + 1;
+  }
+  
+  int NumPorts()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return numPorts;
+  }
+  
+  bool Acquire(int& port)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ports.Ranges().empty())
+    {
+      port = util::net::Endpoint::AnyPort();
+      return true;
+    }
+    
+    if (!nextPort || nextPort > it->To()) nextPort = it->From();
+    
+    // continue round robin from the last port handed out so recently
+    // released ports aren't reused while they may still be in TIME_WAIT
+    auto start = it;
+    int startPort = nextPort;
+    do
+    {
+      int free = FindFree(nextPort, it->To());
+      if (free >= 0)
+      {
+        SetInUse(free, true);
+        nextPort = free + 1;
+        port = free;
+        return true;
+      }
+      
+      if (++it == ports.Ranges().end())
+        it = ports.Ranges().begin();
+      nextPort = it->From();
+    }
+    while (it != start);
+    
+    int free = FindFree(it->From(), startPort - 1);
+    if (free < 0) return false;
+    
+    SetInUse(free, true);
+    nextPort = free + 1;
+    port = free;
+    return true;
+  }
+  
+  void Release(int port)
+  {
+    if (port <= 0) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    SetInUse(port, false);
   }
 
   int inline NextPort()
@@ -89,6 +175,8 @@ inline void InitialisePortAllocators()
 {
   cfg::ConnectUpdatedSlot([]() { PortAllocator<ftp::PortType::Active>::Get().SetPorts(cfg::Get().ActivePorts()); });
   cfg::ConnectUpdatedSlot([]() { PortAllocator<ftp::PortType::Passive>::Get().SetPorts(cfg::Get().PasvPorts()); });
+  // pooled listeners may be on ports no longer in range
+  cfg::ConnectUpdatedSlot([]() { ListenerPool::Get().Flush(); });
 }
 
 } /* ftp namespace */
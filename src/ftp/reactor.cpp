@@ -0,0 +1,292 @@
+#if defined(__linux__)
+
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "ftp/reactor.hpp"
+#include "ftp/client.hpp"
+#include "ftp/control.hpp"
+#include "util/net/tcpsocket.hpp"
+#include "util/error.hpp"
+#include "util/misc.hpp"
+#include "logs/logs.hpp"
+
+namespace ftp
+{
+
+ReactorThread::ReactorThread(Reactor& reactor) :
+  reactor(reactor),
+  epollFd(epoll_create1(EPOLL_CLOEXEC)),
+  shutdown(false),
+  released(false)
+{
+  if (epollFd < 0) throw util::SystemError(errno);
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.ptr = nullptr;
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, interruptPipe.ReadFd(), &ev) < 0)
+  {
+    int errno_ = errno;
+    close(epollFd);
+    throw util::SystemError(errno_);
+  }
+}
+
+ReactorThread::~ReactorThread()
+{
+  close(epollFd);
+}
+
+bool ReactorThread::Arm(Client& client)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (released) return false;
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+  ev.data.ptr = &client;
+
+  int fd = client.Control().socket->Socket();
+  if (epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev) < 0 &&
+      (errno != ENOENT || epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0))
+  {
+    logs::Error("Unable to add client to reactor: %1%", util::Error::Failure(errno).Message());
+    return false;
+  }
+
+  armed.insert(&client);
+  return true;
+}
+
+void ReactorThread::Remove(Client& client)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  armed.erase(&client);
+  (void) epoll_ctl(epollFd, EPOLL_CTL_DEL, client.Control().socket->Socket(), nullptr);
+}
+
+std::vector<Client*> ReactorThread::Release()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  released = true;
+  std::vector<Client*> clients(armed.begin(), armed.end());
+  armed.clear();
+  return clients;
+}
+
+void ReactorThread::Shutdown()
+{
+  shutdown = true;
+  interruptPipe.Interrupt();
+  Join();
+}
+
+void ReactorThread::HandleEvent(Client* client, uint32_t events)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (armed.find(client) == armed.end()) return;
+
+    // command lines, decrypted first for tls, are buffered here so that a
+    // worker is only ever handed a session that has a complete command waiting
+    if (!(events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) &&
+        !client->Control().BufferCommand())
+    {
+      struct epoll_event ev;
+      ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+      ev.data.ptr = client;
+      if (epoll_ctl(epollFd, EPOLL_CTL_MOD, client->Control().socket->Socket(), &ev) == 0)
+        return;
+    }
+
+    armed.erase(client);
+  }
+
+  reactor.Dispatch(*client, *this, false);
+}
+
+void ReactorThread::CheckIdle()
+{
+  std::vector<Client*> expired;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = armed.begin(); it != armed.end();)
+    {
+      if ((*it)->IdleExpired())
+      {
+        (void) epoll_ctl(epollFd, EPOLL_CTL_DEL, (*it)->Control().socket->Socket(), nullptr);
+        expired.push_back(*it);
+        it = armed.erase(it);
+      }
+      else
+        ++it;
+    }
+  }
+
+  for (Client* client : expired)
+    reactor.Dispatch(*client, *this, true);
+}
+
+void ReactorThread::Run()
+{
+  namespace pt = boost::posix_time;
+
+  util::SetProcessTitle("REACTOR");
+
+  struct epoll_event events[maxEvents];
+  pt::ptime nextIdleCheck = pt::microsec_clock::local_time() +
+                            pt::milliseconds(idleCheckInterval);
+
+  while (!shutdown)
+  {
+    int n = epoll_wait(epollFd, events, maxEvents, idleCheckInterval);
+    if (n < 0)
+    {
+      if (errno == EINTR) continue;
+      logs::Error("Reactor epoll failed: %1%", util::Error::Failure(errno).Message());
+      // ensure we don't poll rapidly on repeated failures
+      boost::this_thread::sleep(pt::milliseconds(100));
+      continue;
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+      if (!events[i].data.ptr) interruptPipe.Acknowledge();
+      else HandleEvent(static_cast<Client*>(events[i].data.ptr), events[i].events);
+    }
+
+    pt::ptime now = pt::microsec_clock::local_time();
+    if (now >= nextIdleCheck)
+    {
+      CheckIdle();
+      nextIdleCheck = now + pt::milliseconds(idleCheckInterval);
+    }
+  }
+}
+
+Reactor::Reactor(int numIOThreads, int numWorkers) :
+  numIOThreads(numIOThreads),
+  numWorkers(numWorkers),
+  startedWorkers(0),
+  nextIOThread(0),
+  idleWorkers(0),
+  stopping(false)
+{
+  for (int i = 0; i < numIOThreads; ++i)
+    ioThreads.emplace_back(new ReactorThread(*this));
+}
+
+Reactor::~Reactor()
+{
+}
+
+void Reactor::Start()
+{
+  logs::Debug("Starting reactor with %1% i/o threads and up to %2% workers..",
+              numIOThreads, numWorkers);
+
+  boost::lock_guard<boost::mutex> lock(mutex);
+  for (int i = 0; i < std::min(numWorkers, static_cast<int>(initialWorkers)); ++i)
+    StartWorker();
+
+  for (auto& ioThread : ioThreads)
+    ioThread->Start();
+}
+
+void Reactor::Stop()
+{
+  logs::Debug("Stopping reactor..");
+
+  for (auto& ioThread : ioThreads)
+    ioThread->Shutdown();
+
+  {
+    // any session still waiting on the i/o threads gets one final dispatch
+    // so it's finished and cleaned up the same as in the thread model
+    boost::lock_guard<boost::mutex> lock(mutex);
+    for (auto& ioThread : ioThreads)
+    {
+      for (Client* client : ioThread->Release())
+        jobs.push(Job(client, ioThread.get(), false));
+    }
+    stopping = true;
+  }
+
+  jobReady.notify_all();
+  workers.join_all();
+}
+
+void Reactor::StartWorker()
+{
+  workers.create_thread(boost::bind(&Reactor::Worker, this));
+  ++startedWorkers;
+}
+
+void Reactor::Worker()
+{
+  util::SetProcessTitle("WORKER");
+
+  while (true)
+  {
+    Job job;
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      ++idleWorkers;
+      while (jobs.empty() && !stopping) jobReady.wait(lock);
+      --idleWorkers;
+      if (jobs.empty()) return;
+      job = jobs.front();
+      jobs.pop();
+    }
+
+    bool keep = false;
+    try
+    {
+      keep = job.client->Dispatch(job.idleTimeout);
+    }
+    catch (const boost::thread_interrupted&)
+    {
+    }
+
+    if (!keep || !job.ioThread->Arm(*job.client))
+    {
+      job.ioThread->Remove(*job.client);
+      job.client->Finish();
+    }
+  }
+}
+
+void Reactor::Push(const Job& job)
+{
+  bool startWorker;
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    jobs.push(job);
+    // workers block for the duration of a command, including transfers,
+    // so start another rather than leave sessions queued behind them, until
+    // the configured maximum is reached and they queue anyway
+    startWorker = static_cast<int>(jobs.size()) > idleWorkers && !stopping &&
+                  startedWorkers < numWorkers;
+    if (startWorker) StartWorker();
+  }
+
+  if (!startWorker) jobReady.notify_one();
+}
+
+void Reactor::Add(Client& client)
+{
+  ReactorThread& ioThread = *ioThreads[nextIOThread++ % ioThreads.size()];
+  Push(Job(&client, &ioThread, false));
+}
+
+void Reactor::Dispatch(Client& client, ReactorThread& ioThread, bool idleTimeout)
+{
+  Push(Job(&client, &ioThread, idleTimeout));
+}
+
+} /* ftp namespace */
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef __FTP_REACTOR_HPP
+#define __FTP_REACTOR_HPP
+
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <vector>
+#include <atomic>
+#include <unordered_set>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "util/thread.hpp"
+#include "util/interruptpipe.hpp"
+
+namespace ftp
+{
+
+class Client;
+class Reactor;
+
+class ReactorThread : public util::Thread
+{
+  Reactor& reactor;
+  int epollFd;
+  util::InterruptPipe interruptPipe;
+  std::atomic_bool shutdown;
+
+  std::mutex mutex;
+  std::unordered_set<Client*> armed;
+  bool released;
+
+  static const int maxEvents = 64;
+  static const int idleCheckInterval = 1000; // milliseconds
+
+  void HandleEvent(Client* client, uint32_t events);
+  void CheckIdle();
+  void Run();
+
+public:
+  ReactorThread(Reactor& reactor);
+  ~ReactorThread();
+
+  bool Arm(Client& client);
+  void Remove(Client& client);
+  void Shutdown();
+  std::vector<Client*> Release();
+};
+
+class Reactor
+{
+  struct Job
+  {
+    Client* client;
+    ReactorThread* ioThread;
+    bool idleTimeout;
+
+    Job() : client(nullptr), ioThread(nullptr), idleTimeout(false) { }
+    Job(Client* client, ReactorThread* ioThread, bool idleTimeout) :
+      client(client), ioThread(ioThread), idleTimeout(idleTimeout) { }
+  };
+
+  int numIOThreads;
+  int numWorkers;
+  int startedWorkers;
+  std::vector<std::unique_ptr<ReactorThread>> ioThreads;
+  std::atomic<unsigned> nextIOThread;
+
+  boost::thread_group workers;
+  boost::mutex mutex;
+  boost::condition_variable jobReady;
+  std::queue<Job> jobs;
+  int idleWorkers;
+  bool stopping;
+
+  static const int initialWorkers = 16;
+
+  void StartWorker();
+  void Worker();
+  void Push(const Job& job);
+
+public:
+  Reactor(int numIOThreads, int numWorkers);
+  ~Reactor();
+
+  void Start();
+  void Stop();
+
+  void Add(Client& client);
+  void Dispatch(Client& client, ReactorThread& ioThread, bool idleTimeout);
+};
+
+} /* ftp namespace */
+
+#endif
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cerrno>
+#include <ios>
+#include <fcntl.h>
+#include <unistd.h>
+#include "ftp/readahead.hpp"
+#include "util/error.hpp"
+
+namespace ftp
+{
+
+ReadAhead::ReadAhead(int fd, off_t offset, off_t end, size_t chunkSize, unsigned depth) :
+  fd(fd),
+  offset(offset),
+  end(end),
+  chunkSize(chunkSize),
+  buffers(depth),
+  readIndex(0),
+  writeIndex(0),
+  eof(false),
+  stop(false),
+  error(0)
+{
+  Sequential(fd, offset, end >= 0 ? end - offset : 0);
+  thread = boost::thread(&ReadAhead::Main, this);
+}
+
+ReadAhead::~ReadAhead()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    stop = true;
+  }
+
+  freeCond.notify_one();
+  boost::this_thread::disable_interruption noInterrupt;
+  thread.join();
+}
+
+void ReadAhead::Main()
+{
+  boost::unique_lock<boost::mutex> lock(mutex);
+  while (true)
+  {
+    while (!stop && (buffers[readIndex].ready || eof || error))
+      freeCond.wait(lock);
+    if (stop) break;
+
+    Buffer& buffer = buffers[readIndex];
+    size_t size = chunkSize;
+    off_t readOffset = offset;
+    // nothing past the end of a range is read, it's treated as end of file
+    if (end >= 0) size = std::min<off_t>(size, std::max<off_t>(end - readOffset, 0));
+    lock.unlock();
+
+    // buffers not ready are only touched by this thread
+    if (buffer.data.size() < size) std::vector<char>(size).swap(buffer.data);
+
+    ssize_t len = 0;
+    if (size > 0)
+      while ((len = pread(fd, buffer.data.data(), size, readOffset)) < 0 && errno == EINTR);
+    int errno_ = errno;
+
+    lock.lock();
+    if (len < 0) error = errno_;
+    else if (len == 0) eof = true;
+    else
+    {
+      buffer.len = len;
+      buffer.ready = true;
+      offset += len;
+      readIndex = (readIndex + 1) % buffers.size();
+    }
+
+    readyCond.notify_one();
+
+    if (len > 0 && buffers[readIndex].ready)
+    {
+      // ring is full, pull the next chunk into the page cache while we wait
+      readOffset = offset;
+      if (end >= 0) size = std::min<off_t>(size, std::max<off_t>(end - readOffset, 0));
+      lock.unlock();
+      if (size > 0)
+      {
+#if defined(__linux__)
+        (void) readahead(fd, readOffset, size);
+#else
+        WillNeed(fd, readOffset, size);
+#endif
+      }
+      lock.lock();
+    }
+  }
+}
+
+size_t ReadAhead::Next(char*& data)
+{
+  boost::unique_lock<boost::mutex> lock(mutex);
+  Buffer& buffer = buffers[writeIndex];
+  while (!buffer.ready && !eof && !error) readyCond.wait(lock);
+
+  if (buffer.ready)
+  {
+    data = buffer.data.data();
+    return buffer.len;
+  }
+
+  if (error) throw std::ios_base::failure("read: " + util::ErrnoToMessage(error));
+
+  eof = false;
+  freeCond.notify_one();
+  return 0;
+}
+
+void ReadAhead::Release()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    buffers[writeIndex].ready = false;
+    writeIndex = (writeIndex + 1) % buffers.size();
+  }
+
+  freeCond.notify_one();
+}
+
+void ReadAhead::Sequential(int fd, off_t offset, off_t len)
+{
+#if defined(POSIX_FADV_SEQUENTIAL)
+  (void) posix_fadvise(fd, offset, len, POSIX_FADV_SEQUENTIAL);
+#else
+  (void) fd;
+  (void) offset;
+  (void) len;
+#endif
+}
+
+void ReadAhead::WillNeed(int fd, off_t offset, off_t len)
+{
+#if defined(POSIX_FADV_WILLNEED)
+  (void) posix_fadvise(fd, offset, len, POSIX_FADV_WILLNEED);
+#else
+  (void) fd;
+  (void) offset;
+  (void) len;
+#endif
+}
+
+} /* ftp namespace */
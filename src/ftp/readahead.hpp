@@ -0,0 +1,71 @@
+#ifndef __FTP_READAHEAD_HPP
+#define __FTP_READAHEAD_HPP
+
+#include <atomic>
+#include <vector>
+#include <sys/types.h>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace ftp
+{
+
+// reader thread filling a ring of buffers from disk ahead of the data
+// connection so read stalls overlap network writes rather than add to them
+class ReadAhead
+{
+  struct Buffer
+  {
+    std::vector<char> data;
+    size_t len;
+    bool ready;
+
+    // allocated by the reader thread at the chunk size in use when it's
+    // first filled, and grown with it
+    Buffer() : len(0), ready(false) { }
+  };
+
+  int fd;
+  off_t offset;
+  off_t end;
+  std::atomic<size_t> chunkSize;
+  std::vector<Buffer> buffers;
+  unsigned readIndex;
+  unsigned writeIndex;
+  bool eof;
+  bool stop;
+  int error;
+
+  boost::mutex mutex;
+  boost::condition_variable readyCond;
+  boost::condition_variable freeCond;
+  boost::thread thread;
+
+  void Main();
+
+public:
+  ReadAhead(int fd, off_t offset, off_t end, size_t chunkSize, unsigned depth);
+  /* end is one past the last byte to read, -1 for the end of file */
+  ~ReadAhead();
+
+  void SetChunkSize(size_t size) { chunkSize = size; }
+  /* Size of subsequent reads */
+
+  size_t Next(char*& data);
+  /* Returns 0 once reads have caught up with the end of file, calling */
+  /* Next again retries from there for files that are still growing */
+  /* Throws std::ios_base::failure */
+
+  void Release();
+  /* Hands the buffer returned by Next back to the reader */
+  /* No exceptions */
+
+  static void Sequential(int fd, off_t offset, off_t len = 0);
+  static void WillNeed(int fd, off_t offset, off_t len);
+  /* Page cache hints only, no exceptions */
+};
+
+} /* ftp namespace */
+
+#endif
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <csignal>
 #include <cassert>
 #include <memory>
@@ -5,6 +6,12 @@
 #include <poll.h>
 #include "ftp/server.hpp"
 #include "ftp/client.hpp"
+#include "ftp/reactor.hpp"
+#include "ftp/acceptthread.hpp"
+#include "ftp/listenerpool.hpp"
+#include "ftp/sessionpool.hpp"
+#include "ftp/lookuppool.hpp"
+#include "cfg/get.hpp"
 #include "logs/logs.hpp"
 #include "util/net/tlscontext.hpp"
 #include "util/misc.hpp"
@@ -16,13 +23,55 @@ std::unique_ptr<Server> Server::instance;
 boost::once_flag Server::instanceOnce = BOOST_ONCE_INIT;
 
 Server::Server() :
+  lastLatencyCount(0),
+  lastRejectedCount(0),
   shutdown(false)
 {
 }
 
+Server::~Server()
+{
+}
+
 void Server::Listen(const std::vector<std::string>& validIPs, int port)
 {
   assert(!validIPs.empty());
+  
+  int numAcceptThreads = cfg::Get().AcceptThreads();
+#if !defined(__linux__) || !defined(SO_REUSEPORT)
+  if (numAcceptThreads > 1)
+  {
+    logs::Error("Multiple accept threads are only supported on linux, using one");
+    numAcceptThreads = 1;
+  }
+#endif
+  
+  if (numAcceptThreads > 1)
+  {
+    try
+    {
+      for (int i = 0; i < numAcceptThreads; ++i)
+        acceptThreads.emplace_back(new AcceptThread(*this, validIPs, port));
+    }
+    catch (const util::net::NetworkError& e)
+    {
+      logs::Error("Unable to listen for clients on port %1%: %2%", port, e.Message());
+      throw;
+    }
+    
+    for (const auto& ip : validIPs)
+    {
+      logs::Debug("Listening for clients on %1% with %2% accept threads", 
+                  util::net::Endpoint(ip, port), numAcceptThreads);
+    }
+    
+    // server thread is left only handling tasks
+    fds.resize(1);
+    fds[0].fd = interruptPipe.ReadFd();
+    fds[0].events = POLLIN;
+    return;
+  }
+  
   util::net::Endpoint ep;
   try
   {
@@ -118,19 +167,80 @@ void Server::StopClients()
   for (auto& client : clients)
     client.Interrupt();
   
-  for (auto& client : clients)
-    client.Join();
+  if (reactor)
+  {
+    reactor->Stop();
+    reactor = nullptr;
+  }
+  else
+  {
+    for (auto& client : clients)
+      client.Join();
+  }
     
+  userSessions.clear();
+  sessionUsers.clear();
   clients.clear();
 }
 
-void Server::AcceptClient(util::net::TCPListener& server)
+void Server::StartClient(Client& client)
+{
+  if (reactor) reactor->Add(client);
+  else SessionPool::Get().Add(client);
+}
+
+bool Server::AcceptPending(util::net::TCPListener& listener, std::unique_ptr<Client>& client)
+{
+  client.reset();
+  
+  util::net::Endpoint remoteEndpoint;
+  int socket;
+  try
+  {
+    socket = listener.AcceptSocket(remoteEndpoint);
+  }
+  catch (const util::net::TimeoutError&)
+  {
+    // non-blocking listener has no more pending connections
+    return false;
+  }
+  catch (const util::net::NetworkError& e)
+  {
+    logs::Error("Error while accepting new client: %1%", e.Message());
+    return false;
+  }
+  
+  // decided before anything is allocated for the connection
+  Admission::Keys keys;
+  AdmissionResult result = admission.Admit(remoteEndpoint.IP(), keys);
+  if (result != AdmissionResult::Admitted)
+  {
+    Admission::Refuse(socket, result);
+    return true;
+  }
+  
+  client.reset(new ftp::Client());
+  if (!client->Accept(socket))
+  {
+    admission.Release(keys);
+    client.reset();
+    return true;
+  }
+  
+  admission.Bind(*client, keys);
+  return true;
+}
+
+void Server::AcceptClient(util::net::TCPListener& server, 
+                          const boost::posix_time::ptime& ready)
 {
-  std::unique_ptr<ftp::Client> client(new ftp::Client());
-  if (client->Accept(server)) 
+  std::unique_ptr<ftp::Client> client;
+  if (AcceptPending(server, client) && client)
   {
-    client->Start();
+    StartClient(*client);
     clients.insert(client.release());
+    acceptLatency.Record((boost::posix_time::microsec_clock::local_time() - 
+                          ready).total_microseconds());
   }
 }
 
@@ -151,6 +261,8 @@ void Server::AcceptClients()
   }
   else
   {
+    auto ready = boost::posix_time::microsec_clock::local_time();
+    
     // last pullfd is interrupt pipe
     if (fds.back().revents & POLLIN)
     {
@@ -161,20 +273,95 @@ void Server::AcceptClients()
     for (auto it = fds.begin(); it != fds.end() - 1; ++it)
     {
       if (it->revents & POLLIN)
-        AcceptClient(servers.at(it->fd));
+        AcceptClient(servers.at(it->fd), ready);
     }
   }
 }
 
+void Server::StartReactor()
+{
+  const cfg::Config& config = cfg::Get();
+  if (config.SessionModel() != cfg::SessionModel::Reactor) return;
+  
+#if defined(__linux__)
+  reactor.reset(new Reactor(config.ReactorThreads(), config.ReactorWorkers()));
+  reactor->Start();
+#else
+  logs::Error("Reactor session model is only supported on linux, "
+              "falling back to thread per client");
+#endif
+}
+
+void Server::StartSessionPool()
+{
+  if (reactor) return;
+  const cfg::Config& config = cfg::Get();
+  SessionPool::Get().Start(config.SessionThreads(), config.SessionStackSize() * 1024);
+}
+
+void Server::StartAcceptThreads()
+{
+  if (acceptThreads.empty()) return;
+  logs::Debug("Starting %1% accept threads..", acceptThreads.size());
+  for (auto& acceptThread : acceptThreads)
+    acceptThread->Start();
+}
+
+void Server::StopAcceptThreads()
+{
+  if (acceptThreads.empty()) return;
+  logs::Debug("Stopping accept threads..");
+  for (auto& acceptThread : acceptThreads)
+    acceptThread->Shutdown();
+  acceptThreads.clear();
+  
+  // take ownership of any clients they accepted since we last looked
+  HandleTasks();
+}
+
+void Server::LogAcceptLatency(bool force)
+{
+  auto now = boost::posix_time::second_clock::local_time();
+  if (!force && now < nextLatencyLog) return;
+  nextLatencyLog = now + boost::posix_time::minutes(10);
+  
+  unsigned long long count = acceptLatency.Count();
+  if (count != lastLatencyCount)
+  {
+    lastLatencyCount = count;
+    logs::Debug("Accept latency: %1%", acceptLatency.ToString());
+  }
+  
+  unsigned long long rejectedConnections = admission.RejectedConnections();
+  unsigned long long rejectedRate = admission.RejectedRate();
+  if (rejectedConnections + rejectedRate != lastRejectedCount)
+  {
+    lastRejectedCount = rejectedConnections + rejectedRate;
+    logs::Debug("Connections refused: %1% over connection limit, %2% over rate limit",
+                static_cast<long long>(rejectedConnections), 
+                static_cast<long long>(rejectedRate));
+  }
+}
+
 void Server::Run()
 {
   util::SetProcessTitle("SERVER");
+  StartReactor();
+  StartSessionPool();
+  StartAcceptThreads();
   while (!shutdown)
   {
     AcceptClients();
+    LogAcceptLatency(false);
   }
   
+  StopAcceptThreads();
+  LogAcceptLatency(true);
   StopClients();
+  SessionPool::Get().Stop();
+  ListenerPool::Get().Stop(true);
+  LookupPool::Hostname().Stop();
+  LookupPool::Ident().Stop();
 }
 
 void Server::Shutdown()
@@ -194,10 +381,49 @@ void Server::PushTask(const TaskPtr& task)
   interruptPipe.Interrupt();
 }
 
+const std::vector<Client*>& Server::UserSessions(acl::UserID uid) const
+{
+  static const std::vector<Client*> none;
+  auto it = userSessions.find(uid);
+  return it == userSessions.end() ? none : it->second;
+}
+
+void Server::AddUserSession(Client& client, acl::UserID uid)
+{
+  auto it = sessionUsers.find(&client);
+  if (it != sessionUsers.end())
+  {
+    if (it->second == uid) return;
+    // USER again after a failed password
+    RemoveUserSession(client);
+  }
+  
+  userSessions[uid].push_back(&client);
+  sessionUsers[&client] = uid;
+}
+
+void Server::RemoveUserSession(Client& client)
+{
+  auto it = sessionUsers.find(&client);
+  if (it == sessionUsers.end()) return;
+  
+  auto sessionsIt = userSessions.find(it->second);
+  if (sessionsIt != userSessions.end())
+  {
+    auto& sessions = sessionsIt->second;
+    sessions.erase(std::remove(sessions.begin(), sessions.end(), &client), sessions.end());
+    if (sessions.empty()) userSessions.erase(sessionsIt);
+  }
+  
+  sessionUsers.erase(it);
+}
+
 void Server::CleanupClient(Client& client)
 {
   assert(client.State() == ClientState::Finished);
   client.Join();
+  RemoveUserSession(client);
+  admission.Release(client);
   clients.erase(client);
   logs::Debug("Client finished");
 }
@@ -8,17 +8,22 @@
 #include <queue>
 #include <atomic>
 #include <mutex>
+#include <unordered_map>
 #include <memory>
 #include <poll.h>
 #include <boost/ptr_container/ptr_unordered_map.hpp>
 #include <boost/ptr_container/ptr_unordered_set.hpp>
 #include <boost/thread/once.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include "ftp/task/types.hpp"
 #include "ftp/task/task.hpp"
 #include "util/thread.hpp"
 #include "util/net/tcplistener.hpp"
 #include "util/net/tcpsocket.hpp"
 #include "util/interruptpipe.hpp"
+#include "util/histogram.hpp"
+#include "ftp/admission.hpp"
+#include "acl/types.hpp"
 
 namespace std
 {
@@ -52,6 +57,8 @@ namespace ftp
 {
 
 class Client;
+class Reactor;
+class AcceptThread;
 
 class Server : public util::Thread
 {
@@ -60,6 +67,23 @@ class Server : public util::Thread
   util::InterruptPipe interruptPipe;
 
   boost::ptr_unordered_set<Client, std::hash<Client>, std::equal_to<Client>> clients;
+  // clients by the user they gave with USER, so tasks for one user needn't
+  // look at every client. indexed from the client's own thread when it
+  // starts waiting for the password, which is always queued ahead of its
+  // ClientFinished, and kept until cleanup. the uid each client is indexed
+  // under is recorded so cleanup and a later USER only touch that entry
+  std::unordered_map<acl::UserID, std::vector<Client*>> userSessions;
+  std::unordered_map<const Client*, acl::UserID> sessionUsers;
+  std::unique_ptr<Reactor> reactor;
+  std::vector<std::unique_ptr<AcceptThread>> acceptThreads;
+  
+  // time from a listener becoming readable to the client being started
+  util::Histogram acceptLatency;
+  boost::posix_time::ptime nextLatencyLog;
+  unsigned long long lastLatencyCount;
+  
+  Admission admission;
+  unsigned long long lastRejectedCount;
 
   std::mutex queueMutex;
   std::queue<TaskPtr> queue;
@@ -70,12 +94,23 @@ class Server : public util::Thread
 
   void Listen(const std::vector<std::string>& validIPs, int port);
   void AcceptClients();
-  void AcceptClient(util::net::TCPListener& server);
+  void AcceptClient(util::net::TCPListener& server, 
+                    const boost::posix_time::ptime& ready);
+  bool AcceptPending(util::net::TCPListener& listener, std::unique_ptr<Client>& client);
+  void StartClient(Client& client);
+  void StartAcceptThreads();
+  void StopAcceptThreads();
+  void LogAcceptLatency(bool force);
 
   void Run();
   void HandleTasks();
+  void StartReactor();
+  void StartSessionPool();
   void StopClients();
   void CleanupClient(Client& client);
+  const std::vector<Client*>& UserSessions(acl::UserID uid) const;
+  void AddUserSession(Client& client, acl::UserID uid);
+  void RemoveUserSession(Client& client);
   void PushTask(const TaskPtr& task);  
   
   static std::unique_ptr<Server> instance;
@@ -84,6 +119,8 @@ class Server : public util::Thread
   static void CreateInstance();
   
 public:
+  ~Server();
+
   static bool Initialise(const std::vector<std::string>& validIPs, int port);
   static void Cleanup();
   static Server& Get();
@@ -98,6 +135,9 @@ public:
   friend class task::UserUpdate;
   friend class task::Task;
   friend class task::ClientFinished;
+  friend class task::ClientAccepted;
+  friend class task::ClientWaitingPassword;
+  friend class AcceptThread;
   
   friend void SignalHandler(int);
 };
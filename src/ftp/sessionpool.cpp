@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <string>
+#include <boost/bind.hpp>
+#include <boost/thread/thread_time.hpp>
+#include "ftp/sessionpool.hpp"
+#include "ftp/client.hpp"
+#include "logs/logs.hpp"
+
+namespace ftp
+{
+
+std::unique_ptr<SessionPool> SessionPool::instance;
+boost::once_flag SessionPool::instanceOnce = BOOST_ONCE_INIT;
+
+SessionPool::~SessionPool()
+{
+  Stop();
+}
+
+void SessionPool::Start(int numThreads, size_t stackSize)
+{
+  boost::lock_guard<boost::mutex> lock(mutex);
+  if (stackSize > 0) attributes.set_stack_size(stackSize);
+  minWorkers = numThreads;
+  stopping = false;
+  
+  logs::Debug("Starting %1% session threads with %2% stack..", numThreads,
+              stackSize > 0 ? std::to_string(stackSize / 1024) + "KiB" : "default");
+  for (int i = 0; i < numThreads; ++i)
+    StartWorker();
+}
+
+void SessionPool::Stop()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    if (workers.empty()) return;
+    logs::Debug("Stopping session threads..");
+    stopping = true;
+  }
+  
+  clientReady.notify_all();
+  for (auto& worker : workers)
+    worker.thread->join();
+  workers.clear();
+}
+
+void SessionPool::StartWorker()
+{
+  workers.emplace_back();
+  Worker& worker = workers.back();
+  try
+  {
+    worker.thread.reset(new boost::thread(attributes, boost::bind(&SessionPool::Run, 
+                                                                  this, boost::ref(worker))));
+  }
+  catch (const boost::thread_resource_error&)
+  {
+    workers.pop_back();
+    throw;
+  }
+}
+
+void SessionPool::Run(Worker& worker)
+{
+  while (true)
+  {
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      ++idleWorkers;
+      auto idleUntil = boost::get_system_time() + boost::posix_time::seconds(idleTimeout);
+      while (pending.empty() && !stopping) 
+      {
+        if (clientReady.timed_wait(lock, idleUntil)) continue;
+        if (pending.empty() && Retire(worker))
+        {
+          --idleWorkers;
+          return;
+        }
+        idleUntil = boost::get_system_time() + boost::posix_time::seconds(idleTimeout);
+      }
+      --idleWorkers;
+      if (pending.empty()) return;
+      worker.client = pending.front();
+      pending.pop_front();
+      running.insert(std::make_pair(worker.client, &worker));
+    }
+    
+    worker.client->RunSession();
+    
+    {
+      boost::lock_guard<boost::mutex> lock(mutex);
+      running.erase(worker.client);
+      worker.client = nullptr;
+      
+      // an interrupt that arrived after the client last checked for one
+      // mustn't carry over to the next client, none can arrive now it's
+      // no longer in running
+      try
+      {
+        boost::this_thread::interruption_point();
+      }
+      catch (const boost::thread_interrupted&)
+      {
+      }
+    }
+    
+    clientDone.notify_all();
+  }
+}
+
+bool SessionPool::Retire(Worker& worker)
+{
+  // the ones started ahead of time are kept, as are all while stopping so
+  // Stop can join them
+  if (stopping || static_cast<int>(workers.size()) <= minWorkers) return false;
+  
+  worker.thread->detach();
+  workers.remove_if([&worker](const Worker& w) { return &w == &worker; });
+  return true;
+}
+
+void SessionPool::Add(Client& client)
+{
+  bool startWorker;
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    pending.push_back(&client);
+    startWorker = static_cast<int>(pending.size()) > idleWorkers;
+    if (startWorker)
+    {
+      try
+      {
+        StartWorker();
+      }
+      catch (const boost::thread_resource_error&)
+      {
+        // only refused when nothing else is free to take it
+        if (idleWorkers > 0) startWorker = false;
+        else
+        {
+          pending.pop_back();
+          throw;
+        }
+      }
+    }
+  }
+  
+  if (!startWorker) clientReady.notify_one();
+}
+
+void SessionPool::Interrupt(Client& client)
+{
+  boost::lock_guard<boost::mutex> lock(mutex);
+  auto it = running.find(&client);
+  if (it != running.end()) it->second->thread->interrupt();
+}
+
+void SessionPool::Join(Client& client)
+{
+  boost::unique_lock<boost::mutex> lock(mutex);
+  while (running.find(&client) != running.end() ||
+         std::find(pending.begin(), pending.end(), &client) != pending.end())
+  {
+    clientDone.wait(lock);
+  }
+}
+
+size_t SessionPool::NumThreads()
+{
+  boost::lock_guard<boost::mutex> lock(mutex);
+  return workers.size();
+}
+
+} /* ftp namespace */
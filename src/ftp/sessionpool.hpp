@@ -0,0 +1,86 @@
+#ifndef __FTP_SESSIONPOOL_HPP
+#define __FTP_SESSIONPOOL_HPP
+
+#include <deque>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/once.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace ftp
+{
+
+class Client;
+
+// threads for the thread per client session model, started ahead of time
+// with a small stack and handed a new client each time their last one
+// finishes, more are started when all are busy and those above the number
+// started ahead of time exit once they've been idle for a while
+class SessionPool
+{
+  struct Worker
+  {
+    std::unique_ptr<boost::thread> thread;
+    Client* client;
+    
+    Worker() : client(nullptr) { }
+  };
+
+  boost::mutex mutex;
+  boost::condition_variable clientReady;
+  boost::condition_variable clientDone;
+  std::list<Worker> workers;
+  std::deque<Client*> pending;
+  std::unordered_map<Client*, Worker*> running;
+  boost::thread::attributes attributes;
+  int minWorkers;
+  int idleWorkers;
+  bool stopping;
+
+  static const int idleTimeout = 60; // seconds
+
+  static std::unique_ptr<SessionPool> instance;
+  static boost::once_flag instanceOnce;
+
+  static void CreateInstance() { instance.reset(new SessionPool()); }
+
+  SessionPool() : minWorkers(0), idleWorkers(0), stopping(false) { }
+
+  void StartWorker();
+  void Run(Worker& worker);
+  bool Retire(Worker& worker);
+
+public:
+  ~SessionPool();
+
+  void Start(int numThreads, size_t stackSize);
+  /* stackSize in bytes, 0 for the system default */
+  /* Throws boost::thread_resource_error */
+  
+  void Stop();
+  /* Waits for clients already handed out to finish */
+  /* No exceptions */
+
+  void Add(Client& client);
+  /* Throws boost::thread_resource_error when no thread could be started */
+  
+  void Interrupt(Client& client);
+  void Join(Client& client);
+  /* Both no-ops for a client not handed to the pool */
+  /* No exceptions */
+  
+  size_t NumThreads();
+
+  static SessionPool& Get()
+  {
+    boost::call_once(&CreateInstance, instanceOnce);
+    return *instance;
+  }
+};
+
+} /* ftp namespace */
+
+#endif
@@ -23,12 +23,11 @@ class SpeedControl
 {
 private:
   long long minimumSpeed;
-  long long maximumSpeed;
   const TransferState& state;
-  std::vector<const cfg::SpeedLimit*> globalLimits;
-  SpeedCounter& globalCounter;
+  TokenBucket transferBucket;
+  std::vector<TokenBucketPtr> buckets;
+  long long lastBytes;
   boost::posix_time::ptime lastMinimumOk;
-  SpeedInfoOpt lastSpeedInfo;
   
   static const int minimumSpeedKickTime = 5;
   
@@ -47,52 +46,50 @@ private:
   }
 
 protected:
-  SpeedControl(int minimumSpeed, int maximumSpeed, 
+  SpeedControl(int minimumSpeed, long long maximumSpeed, 
                   const TransferState& state, 
                   std::vector<const cfg::SpeedLimit*>&& globalLimits,
                   SpeedCounter& globalCounter) :
     minimumSpeed(minimumSpeed),
-    maximumSpeed(maximumSpeed),
     state(state),
-    globalLimits(globalLimits),
-    globalCounter(globalCounter),
+    transferBucket(maximumSpeed > 0 ? maximumSpeed * 1024 : 0),
+    lastBytes(state.Bytes()),
     lastMinimumOk(boost::posix_time::microsec_clock::local_time())
   {
+    // shared buckets are looked up once here, not for every buffer
+    for (const auto* limit : globalLimits)
+      buckets.emplace_back(globalCounter.Bucket(*limit));
   }
   
 public:
   inline void Apply()
   {
-    if (minimumSpeed == 0 && maximumSpeed == 0 && globalLimits.empty()) return;
+    if (minimumSpeed <= 0 && transferBucket.Rate() <= 0 && buckets.empty()) return;
 
-    auto speedInfo = ftp::SpeedInfo(state.Duration(), state.Bytes());
-    
+    long long bytes = state.Bytes();
     if (minimumSpeed > 0)
     {
-      CheckMinimum(speedInfo.Speed() / 1024);
+      CheckMinimum(ftp::SpeedInfo(state.Duration(), bytes).Speed() / 1024);
     }
     
-    boost::posix_time::time_duration sleepTime(boost::posix_time::microseconds(0));
-    
-    if (maximumSpeed > 0)
-    {
-      sleepTime = stats::SpeedLimitSleep(speedInfo.xfertime, speedInfo.bytes, 
-                                         maximumSpeed * 1024);
-    }
+    long long sent = bytes - lastBytes;
+    lastBytes = bytes;
+    if (sent <= 0) return;
     
-    if (!globalLimits.empty())
+    // every level is charged for what was sent and we wait on whichever
+    // is furthest behind, global / section / group / user limits come from
+    // maximum_speed path masks and acls, the transfer limit from the user
+    long long now = TokenBucket::Now();
+    long long wait = transferBucket.Consume(sent, now);
+    for (auto& bucket : buckets)
     {
-      sleepTime = std::max(sleepTime, globalCounter.Update(lastSpeedInfo, speedInfo, globalLimits));
+      wait = std::max(wait, bucket->Consume(sent, now));
     }
     
-    boost::this_thread::sleep(sleepTime);
-    lastSpeedInfo = speedInfo;
+    if (wait > 0) boost::this_thread::sleep(boost::posix_time::microseconds(wait));
   }
   
-  virtual ~SpeedControl()
-  {
-    globalCounter.Clear(lastSpeedInfo, globalLimits);
-  }
+  virtual ~SpeedControl() { }
 };
 
 class UploadSpeedControl : public SpeedControl
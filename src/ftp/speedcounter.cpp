@@ -1,57 +1,33 @@
-#include <algorithm>
 #include "ftp/speedcounter.hpp"
-#include "stats/util.hpp"
 #include "cfg/setting.hpp"
 
 namespace ftp
 {
 
-boost::posix_time::time_duration 
-SpeedCounter::Update(const SpeedInfoOpt& last, const SpeedInfo& current, const SpeedLimitList& limits)
+TokenBucketPtr SpeedCounter::Bucket(const cfg::SpeedLimit& limit)
 {
-  boost::posix_time::time_duration sleep = boost::posix_time::microseconds(0);
+  // entries with the same path mask but different acls are separate limits
+  std::string key = limit.Path() + " " + limit.ACLString();
+  long long rate = getSpeedLimit(limit) * 1024;
   std::lock_guard<std::mutex> lock(mutex);
-  for (const auto& limit : limits)
+  
+  TokenBucketPtr bucket = buckets[key].lock();
+  if (bucket)
   {
-    auto it = speeds.find(limit->Path());
-    if (it == speeds.end())
-    {
-      auto result = speeds.insert(std::make_pair(
-            limit->Path(), std::make_pair(1, current)));
-      it = result.first;
-    }
-    else
-    {
-      if (last) it->second.second -= *last;
-      else ++it->second.first;
-      it->second.second += current;
-    }
-
-    sleep = std::max(sleep, stats::SpeedLimitSleep(it->second.second.xfertime / it->second.first, 
-                                                   it->second.second.bytes, 
-                                                   getSpeedLimit(*limit) * 1024));
+    // limit may have changed on config reload
+    bucket->SetRate(rate);
+    return bucket;
   }
-  return sleep;
-}
 
-void SpeedCounter::Clear(const SpeedInfoOpt& last, const SpeedLimitList& limits)
-{
-  if (!last) return;
-  
-  std::lock_guard<std::mutex> lock(mutex);
-  for (const auto& limit : limits)
+  for (auto it = buckets.begin(); it != buckets.end();)
   {
-    auto it = speeds.find(limit->Path());
-    if (it != speeds.end())
-    {
-      if (--it->second.first <= 0)
-      {
-        speeds.erase(it);
-      }
-      else
-        it->second.second -= *last;
-    }
+    if (it->second.expired()) it = buckets.erase(it);
+    else ++it;
   }
+  
+  bucket = std::make_shared<TokenBucket>(rate);
+  buckets[key] = bucket;
+  return bucket;
 }
 
 } /* ftp namespace */
@@ -3,10 +3,13 @@
 
 #include <cassert>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <chrono>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <unordered_map>
 #include <functional>
-#include <boost/optional.hpp>
 #include <string>
 #include "acl/types.hpp"
 
@@ -60,12 +63,54 @@ struct SpeedInfo
   }
 };
 
-typedef boost::optional<SpeedInfo> SpeedInfoOpt;
+// lock free token bucket tracking the time at which it next has capacity,
+// transfers sharing a bucket each push that time on by the cost of what they
+// sent, so they're paced in turn according to the bytes they move
+class TokenBucket
+{
+  std::atomic<long long> rate;
+  std::atomic<long long> nextFree;
+  
+  // capacity an idle bucket may build up, in microseconds of its rate
+  static const long long burst = 100000;
+
+public:
+  explicit TokenBucket(long long rate) : rate(rate), nextFree(0) { }
+  
+  long long Rate() const { return rate; }
+  void SetRate(long long rate) { this->rate = rate; }
+  
+  long long Consume(long long bytes, long long now)
+  {
+    long long rate = this->rate;
+    if (rate <= 0) return 0;
+    
+    long long cost = bytes * 1000000 / rate;
+    long long next = nextFree.load(std::memory_order_relaxed);
+    long long newNext;
+    do
+    {
+      newNext = std::max(next, now - burst) + cost;
+    }
+    while (!nextFree.compare_exchange_weak(next, newNext));
+    
+    return std::max(0LL, newNext - now);
+  }
+  /* Returns microseconds to wait before sending more */
+  
+  static long long Now()
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+};
+
+typedef std::shared_ptr<TokenBucket> TokenBucketPtr;
 
 class SpeedCounter
 {
   std::mutex mutex;
-  std::unordered_map<std::string, std::pair<int, SpeedInfo>> speeds;
+  std::unordered_map<std::string, std::weak_ptr<TokenBucket>> buckets;
   std::function<long long(const cfg::SpeedLimit&)> getSpeedLimit;
 
   SpeedCounter(const std::function<long long(const cfg::SpeedLimit&)>& getSpeedLimit) :
@@ -78,12 +123,8 @@ class SpeedCounter
   SpeedCounter(SpeedCounter&&) = delete;
   
 public:
-
-  typedef std::vector<const cfg::SpeedLimit*>& SpeedLimitList;
-  
-  boost::posix_time::time_duration 
-  Update(const SpeedInfoOpt& last, const SpeedInfo& current, const SpeedLimitList& limits);
-  void Clear(const SpeedInfoOpt& last, const SpeedLimitList& limits);
+  TokenBucketPtr Bucket(const cfg::SpeedLimit& limit);
+  /* Bucket shared by all transfers limited by the same config entry */
   
   friend class Counter;
 };
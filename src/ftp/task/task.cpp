@@ -21,14 +21,11 @@ void Task::Push()
 void KickUser::Execute(Server& server)
 {
   int kicked = 0;
-  for (auto& client : server.clients)
+  for (auto client : server.UserSessions(uid))
   {
-    if (client.User().ID() == uid)
-    {
-      client.Interrupt();
-      ++kicked;
-      if (oneOnly) break;
-    }
+    client->Interrupt();
+    ++kicked;
+    if (oneOnly) break;
   }
   
   promise.set_value(kicked);
@@ -37,15 +34,15 @@ void KickUser::Execute(Server& server)
 void LoginKickUser::Execute(Server& server)
 {
   Result result;
-  for (auto& client: server.clients)
+  for (auto client : server.UserSessions(uid))
   {
-    if (client.User().ID() == uid && client.State() == ftp::ClientState::LoggedIn)
+    if (client->State() == ftp::ClientState::LoggedIn)
     {
       if (!result.kicked)
       {
-        client.Interrupt();
+        client->Interrupt();
         result.kicked = true;
-        result.idleTime = client.IdleTime();
+        result.idleTime = client->IdleTime();
       }
       
       ++result.logins;
@@ -112,11 +109,11 @@ void Exit::Execute(Server&)
 
 void UserUpdate::Execute(Server& server)
 {
-  for (auto& client: server.clients)
+  for (auto client : server.UserSessions(uid))
   {
-    if (client.State() == ClientState::LoggedIn && client.User().ID() == uid)
+    if (client->State() == ClientState::LoggedIn)
     {
-      client.SetUserUpdated();
+      client->SetUserUpdated();
     }
   }
 }
@@ -126,5 +123,15 @@ void ClientFinished::Execute(Server& server)
   server.CleanupClient(client);
 }
 
+void ClientAccepted::Execute(Server& server)
+{
+  server.clients.insert(client);
+}
+
+void ClientWaitingPassword::Execute(Server& server)
+{
+  server.AddUserSession(client, uid);
+}
+
 }
 }
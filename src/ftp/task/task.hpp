@@ -112,6 +112,25 @@ public:
   void Execute(Server& server);
 };
 
+class ClientAccepted : public Task
+{
+  Client* client;
+  
+public:
+  ClientAccepted(Client* client) : client(client) { }
+  void Execute(Server& server);
+};
+
+class ClientWaitingPassword : public Task
+{
+  Client& client;
+  acl::UserID uid;
+  
+public:
+  ClientWaitingPassword(Client& client, acl::UserID uid) : client(client), uid(uid) { }
+  void Execute(Server& server);
+};
+
 // end
 }
 }
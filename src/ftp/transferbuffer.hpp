@@ -0,0 +1,95 @@
+#ifndef __FTP_TRANSFERBUFFER_HPP
+#define __FTP_TRANSFERBUFFER_HPP
+
+#include <algorithm>
+#include <vector>
+#include <boost/optional.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "cfg/setting.hpp"
+
+namespace ftp
+{
+
+// size of the chunks a transfer is read and written in, in adaptive mode the
+// size is doubled each measurement window for as long as it improves speed
+class TransferBuffer
+{
+  size_t size;
+  size_t maxSize;
+  bool adaptive;
+  bool adapting;
+  std::vector<char> buffer;
+
+  boost::posix_time::ptime windowStart;
+  long long windowBytes;
+  double lastSpeed;
+
+  static const size_t defaultSize = 16384;
+  static const size_t adaptiveMaxSize = 1048576;
+  static const int windowLength = 500; // milliseconds
+  static constexpr double minimumGain = 1.05;
+
+public:
+  explicit TransferBuffer(const boost::optional<const cfg::TransferBuffer&>& config) :
+    size(defaultSize),
+    maxSize(defaultSize),
+    adaptive(false),
+    adapting(false),
+    windowStart(boost::posix_time::microsec_clock::local_time()),
+    windowBytes(0),
+    lastSpeed(0)
+  {
+    if (config)
+    {
+      if (config->BufferSize() > 0)
+        size = maxSize = config->BufferSize();
+      else
+      {
+        maxSize = adaptiveMaxSize;
+        adaptive = adapting = true;
+      }
+    }
+  }
+
+  char* Data()
+  {
+    // grown along with size rather than allocated at the largest it may
+    // reach, so a transfer that settles small never touches the rest. the
+    // pointer is only valid until the next Update
+    if (buffer.size() < size) std::vector<char>(size).swap(buffer);
+    return buffer.data();
+  }
+
+  size_t Size() const { return size; }
+  bool Adaptive() const { return adaptive; }
+
+  void Update(size_t len)
+  {
+    if (!adapting) return;
+
+    windowBytes += len;
+    auto now = boost::posix_time::microsec_clock::local_time();
+    long long elapsed = (now - windowStart).total_milliseconds();
+    if (elapsed < windowLength) return;
+
+    double speed = windowBytes / (elapsed / 1000.0);
+    if (speed > lastSpeed * minimumGain && size < maxSize)
+    {
+      lastSpeed = speed;
+      size = std::min(size * 2, maxSize);
+    }
+    else
+    {
+      // last doubling gained nothing, settle on the size before it
+      if (speed < lastSpeed) size /= 2;
+      adapting = false;
+    }
+
+    windowStart = now;
+    windowBytes = 0;
+  }
+};
+
+} /* ftp namespace */
+
+#endif
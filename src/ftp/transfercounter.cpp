@@ -6,31 +6,90 @@
 namespace ftp
 {
 
+bool TransferCounter::AcquireGlobal(bool exempt, int maxGlobal)
+{
+  if (exempt || maxGlobal == -1)
+  {
+    global.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  
+  int current = global.load(std::memory_order_relaxed);
+  do
+  {
+    if (current >= maxGlobal) return false;
+  }
+  while (!global.compare_exchange_weak(current, current + 1, std::memory_order_relaxed));
+  return true;
+}
+
+CounterResult TransferCounter::Acquire(Shard& shard, acl::UserID uid, int limit, 
+                                       bool exempt, int maxGlobal)
+{
+  auto it = shard.personal.find(uid);
+  int count = it == shard.personal.end() ? 0 : it->second;
+  if (count >= limit && limit != -1) return CounterResult::PersonalFail;
+  if (!AcquireGlobal(exempt, maxGlobal)) return CounterResult::GlobalFail;
+  if (it == shard.personal.end()) shard.personal.insert(std::make_pair(uid, 1));
+  else ++it->second;
+  return CounterResult::Okay;
+}
+
+void TransferCounter::Release(Shard& shard, acl::UserID uid)
+{
+  auto it = shard.personal.find(uid);
+  assert(it != shard.personal.end() && it->second > 0);
+  if (--it->second == 0) shard.personal.erase(it);
+  int previous = global.fetch_sub(1, std::memory_order_relaxed);
+  assert(previous > 0);
+  (void) previous;
+}
+
 CounterResult TransferCounter::Start(acl::UserID uid, int limit, bool exempt)
 {
   int maxGlobal = getMaxGlobal();
   
-  std::lock_guard<std::mutex> lock(mutex);
-  int& count = personal[uid];
-  if (count >= limit && limit != -1) return CounterResult::PersonalFail;
-  if (!exempt && maxGlobal != -1 && global >= maxGlobal)
+  Shard& shard = ShardFor(uid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return Acquire(shard, uid, limit, exempt, maxGlobal);
+}
+
+void TransferCounter::Stop(acl::UserID uid)
+{
+  Shard& shard = ShardFor(uid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  Release(shard, uid);
+}
+
+CounterResult TransferCounter::Start(acl::UserID uid, int limit, bool exempt, const std::string& path)
+{
+  int maxGlobal = getMaxGlobal();
+  
+  Shard& shard = ShardFor(uid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto key = std::make_pair(uid, path);
+  auto it = shard.segments.find(key);
+  if (it == shard.segments.end())
   {
-    return CounterResult::GlobalFail;
+    CounterResult result = Acquire(shard, uid, limit, exempt, maxGlobal);
+    if (result != CounterResult::Okay) return result;
+    it = shard.segments.insert(std::make_pair(key, 0)).first;
   }
-  ++count;
-  ++global;
+  
+  ++it->second;
   return CounterResult::Okay;
 }
 
-void TransferCounter::Stop(acl::UserID uid)
+void TransferCounter::Stop(acl::UserID uid, const std::string& path)
 {
-  std::lock_guard<std::mutex> lock(mutex);
-  int& count = personal[uid];
-  assert(count > 0);
-  --count;
-  assert(global > 0);
-  --global;
+  Shard& shard = ShardFor(uid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.segments.find(std::make_pair(uid, path));
+  assert(it != shard.segments.end() && it->second > 0);
+  if (--it->second > 0) return;
+  
+  shard.segments.erase(it);
+  Release(shard, uid);
 }
 
 } /* ftp namespace */
-
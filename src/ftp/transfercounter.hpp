@@ -1,8 +1,12 @@
 #ifndef __TRANSFERCOUNTER_HPP
 #define __TRANSFERCOUNTER_HPP
 
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
+#include <map>
+#include <string>
+#include <utility>
 #include <functional>
 #include "acl/types.hpp"
 
@@ -13,24 +17,47 @@ enum class CounterResult : int;
 
 class TransferCounter
 {
-  std::mutex mutex;
-  int global;
-  std::unordered_map<acl::UserID, int> personal;
+  // a user's counts, including their segments, always live in the same
+  // shard, the global count is claimed lock free against the limit
+  struct alignas(64) Shard
+  {
+    std::mutex mutex;
+    std::unordered_map<acl::UserID, int> personal;
+    // concurrent segments of one file by a user, sharing a single slot
+    std::map<std::pair<acl::UserID, std::string>, int> segments;
+  };
+  
+  constexpr static size_t numShards = 16;
+  
+  std::atomic<int> global;
+  Shard shards[numShards];
   std::function<int(void)> getMaxGlobal;
 
-  TransferCounter(const std::function<int(void)>& getMaxGlobal) :
-    global(0), getMaxGlobal(getMaxGlobal)
-  { }
-  
+  Shard& ShardFor(acl::UserID uid) { return shards[static_cast<size_t>(uid) % numShards]; }
+  bool AcquireGlobal(bool exempt, int maxGlobal);
+  CounterResult Acquire(Shard& shard, acl::UserID uid, int limit, bool exempt, int maxGlobal);
+  void Release(Shard& shard, acl::UserID uid);
+
   TransferCounter& operator=(const TransferCounter&) = delete;
   TransferCounter& operator=(TransferCounter&&) = delete;
   TransferCounter(const TransferCounter&) = delete;
   TransferCounter(TransferCounter&&) = delete;
   
 public:
+  explicit TransferCounter(const std::function<int(void)>& getMaxGlobal) :
+    global(0), getMaxGlobal(getMaxGlobal)
+  { }
+  /* Only Counter's instances are used by the server, others are for */
+  /* tools/bench */
+  
   CounterResult Start(acl::UserID uid, int limit, bool exempt);
   void Stop(acl::UserID uid);
   
+  CounterResult Start(acl::UserID uid, int limit, bool exempt, const std::string& path);
+  void Stop(acl::UserID uid, const std::string& path);
+  /* Segments of a file already being transferred by the user are not */
+  /* counted again */
+  
   friend class Counter;
 };
 
@@ -0,0 +1,438 @@
+#if defined(EBFTPD_IO_URING)
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <ios>
+#include <atomic>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "ftp/uringengine.hpp"
+#include "ftp/data.hpp"
+#include "util/net/error.hpp"
+#include "util/error.hpp"
+#include "util/scopeguard.hpp"
+#include "logs/logs.hpp"
+
+namespace ftp
+{
+
+namespace
+{
+boost::thread_specific_ptr<UringEngine> threadEngine;
+std::atomic_bool unavailableLogged(false);
+
+void ThrowDiskError(const std::string& op, int errno_)
+{
+  throw std::ios_base::failure(op + ": " + util::ErrnoToMessage(errno_));
+}
+
+void ThrowNetworkError(int errno_)
+{
+  if (errno_ == EAGAIN || errno_ == EWOULDBLOCK || errno_ == ETIMEDOUT)
+    throw util::net::TimeoutError();
+  throw util::net::NetworkSystemError(errno_);
+}
+
+}
+
+UringEngine::UringEngine() :
+  memory(bufferCount * bufferSize),
+  inflight(0),
+  controlArmed(false)
+{
+  int ret = io_uring_queue_init(queueDepth, &ring, 0);
+  if (ret < 0) throw util::SystemError(-ret);
+
+  struct iovec iov[bufferCount];
+  for (unsigned i = 0; i < bufferCount; ++i)
+  {
+    iov[i].iov_base = BufferData(i);
+    iov[i].iov_len = bufferSize;
+  }
+
+  ret = io_uring_register_buffers(&ring, iov, bufferCount);
+  if (ret < 0)
+  {
+    io_uring_queue_exit(&ring);
+    throw util::SystemError(-ret);
+  }
+}
+
+UringEngine::~UringEngine()
+{
+  Cancel();
+  io_uring_queue_exit(&ring);
+}
+
+UringEngine* UringEngine::Get()
+{
+  if (!threadEngine.get())
+  {
+    try
+    {
+      threadEngine.reset(new UringEngine());
+    }
+    catch (const util::SystemError& e)
+    {
+      if (!unavailableLogged.exchange(true))
+        logs::Error("Unable to initialise io_uring, using default transfer path: %1%", e.Message());
+      return nullptr;
+    }
+  }
+
+  return threadEngine.get();
+}
+
+struct io_uring_sqe* UringEngine::GetSQE(unsigned tag)
+{
+  struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+  if (!sqe)
+  {
+    io_uring_submit(&ring);
+    sqe = io_uring_get_sqe(&ring);
+    // queue depth exceeds the most operations we ever have in flight
+    assert(sqe);
+  }
+
+  io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<uintptr_t>(tag)));
+  ++inflight;
+  return sqe;
+}
+
+void UringEngine::Submit()
+{
+  int ret;
+  while ((ret = io_uring_submit(&ring)) == -EINTR)
+    boost::this_thread::interruption_point();
+  if (ret < 0) throw util::net::NetworkSystemError(-ret);
+}
+
+void UringEngine::ArmControl(Data& data)
+{
+  if (controlArmed) return;
+  io_uring_prep_poll_add(GetSQE(controlTag), data.ControlSocket(), POLLIN);
+  controlArmed = true;
+}
+
+UringEngine::Completion UringEngine::Wait(Data& data)
+{
+  const util::TimePair& timeout = data.socket.Timeout();
+
+  while (true)
+  {
+    struct __kernel_timespec ts;
+    ts.tv_sec = timeout.Seconds();
+    ts.tv_nsec = timeout.Microseconds() * 1000;
+
+    struct io_uring_cqe* cqe;
+    int ret = io_uring_wait_cqe_timeout(&ring, &cqe, &ts);
+    boost::this_thread::interruption_point();
+    if (ret == -EINTR) continue;
+    if (ret == -ETIME) throw util::net::TimeoutError();
+    if (ret < 0) throw util::net::NetworkSystemError(-ret);
+
+    Completion c;
+    c.tag = static_cast<unsigned>(reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe)));
+    c.result = cqe->res;
+    io_uring_cqe_seen(&ring, cqe);
+    --inflight;
+
+    if (c.tag == cancelTag) continue;
+    if (c.tag == controlTag)
+    {
+      controlArmed = false;
+      if (c.result < 0) ThrowNetworkError(-c.result);
+      if (c.result > 0) data.HandleControl(c.result);
+      ArmControl(data);
+      Submit();
+      continue;
+    }
+
+    return c;
+  }
+}
+
+void UringEngine::Cancel()
+{
+  try
+  {
+    for (unsigned i = 0; i < bufferCount; ++i)
+    {
+      if (buffers[i].op != Op::None)
+      {
+        io_uring_prep_cancel(GetSQE(cancelTag),
+            reinterpret_cast<void*>(static_cast<uintptr_t>(i)), 0);
+      }
+    }
+
+    if (controlArmed)
+    {
+      io_uring_prep_cancel(GetSQE(cancelTag),
+          reinterpret_cast<void*>(static_cast<uintptr_t>(controlTag)), 0);
+    }
+
+    io_uring_submit(&ring);
+
+    while (inflight > 0)
+    {
+      struct io_uring_cqe* cqe;
+      int ret = io_uring_wait_cqe(&ring, &cqe);
+      if (ret == -EINTR) continue;
+      if (ret < 0) break;
+      io_uring_cqe_seen(&ring, cqe);
+      --inflight;
+    }
+  }
+  catch (const std::exception& e)
+  {
+    logs::Error("Error while cancelling io_uring operations: %1%", e.what());
+  }
+
+  for (auto& buffer : buffers) buffer = Buffer();
+  controlArmed = false;
+}
+
+void UringEngine::PrepRead(unsigned i, int fd, off_t offset)
+{
+  Buffer& b = buffers[i];
+  b.op = Op::Read;
+  b.offset = offset;
+  b.len = 0;
+  b.done = 0;
+  b.ready = false;
+  io_uring_prep_read_fixed(GetSQE(i), fd, BufferData(i), bufferSize, offset, i);
+}
+
+void UringEngine::PrepWrite(unsigned i, int fd)
+{
+  Buffer& b = buffers[i];
+  b.op = Op::Write;
+  io_uring_prep_write_fixed(GetSQE(i), fd, BufferData(i) + b.done,
+                            b.len - b.done, b.offset + b.done, i);
+}
+
+void UringEngine::PrepSend(unsigned i, int socket)
+{
+  Buffer& b = buffers[i];
+  b.op = Op::Send;
+  io_uring_prep_send(GetSQE(i), socket, BufferData(i) + b.done,
+                     b.len - b.done, MSG_NOSIGNAL);
+}
+
+void UringEngine::PrepRecv(unsigned i, int socket)
+{
+  Buffer& b = buffers[i];
+  b.op = Op::Recv;
+  b.len = 0;
+  b.done = 0;
+  io_uring_prep_recv(GetSQE(i), socket, BufferData(i), bufferSize, 0);
+}
+
+void UringEngine::DownloadPipeline(Data& data, int fd, off_t& offset,
+                                   const UpdateFunction& update)
+{
+  int socket = data.socket.Socket();
+  off_t readOffset = offset;
+  unsigned nextSend = 0;
+  bool sending = false;
+  bool eof = false;
+
+  ArmControl(data);
+  for (unsigned i = 0; i < bufferCount; ++i)
+  {
+    PrepRead(i, fd, readOffset);
+    readOffset += bufferSize;
+  }
+  Submit();
+
+  while (!eof || sending)
+  {
+    Completion c = Wait(data);
+    Buffer& b = buffers[c.tag];
+
+    if (b.op == Op::Read)
+    {
+      b.op = Op::None;
+      if (c.result < 0) ThrowDiskError("read", -c.result);
+      b.len = c.result;
+      b.ready = true;
+    }
+    else
+    if (b.op == Op::Send)
+    {
+      b.op = Op::None;
+      if (c.result < 0) ThrowNetworkError(-c.result);
+      b.done += c.result;
+      if (b.done < b.len)
+      {
+        PrepSend(c.tag, socket);
+        Submit();
+        continue;
+      }
+
+      size_t len = b.len;
+      sending = false;
+      offset = b.offset + len;
+      ++nextSend;
+      if (!eof)
+      {
+        PrepRead(c.tag, fd, readOffset);
+        readOffset += bufferSize;
+        Submit();
+      }
+
+      update(len);
+    }
+
+    // sends are issued strictly in file order, reads may complete in any order
+    Buffer& next = buffers[nextSend % bufferCount];
+    if (!sending && !eof && next.ready)
+    {
+      next.ready = false;
+      // a short read means we've caught up with the end of file, any reads
+      // queued beyond it are stale and are discarded by Cancel
+      if (next.len < bufferSize) eof = true;
+      if (next.len > 0)
+      {
+        PrepSend(nextSend % bufferCount, socket);
+        sending = true;
+        Submit();
+      }
+    }
+  }
+}
+
+void UringEngine::Download(Data& data, int fd, off_t offset,
+                           const GrowingFunction& growing,
+                           const UpdateFunction& update)
+{
+  auto cancelGuard = util::MakeScopeExit([&]{ Cancel(); });
+  // io_uring fails non-blocking sockets with EAGAIN rather than waiting
+  data.SetNonBlocking(false);
+
+  while (true)
+  {
+    DownloadPipeline(data, fd, offset, update);
+    Cancel();
+    if (!growing()) break;
+    boost::this_thread::sleep(boost::posix_time::microseconds(10000));
+  }
+
+  (void) cancelGuard;
+}
+
+void UringEngine::Upload(Data& data, int fd, const UpdateFunction& update)
+{
+  auto cancelGuard = util::MakeScopeExit([&]{ Cancel(); });
+  data.SetNonBlocking(false);
+
+  // writes complete out of order so must be positioned explicitly, resumed
+  // uploads are opened for append which would ignore the offset
+  int flags = fcntl(fd, F_GETFL);
+  if (flags < 0) ThrowDiskError("fcntl", errno);
+  if ((flags & O_APPEND) && fcntl(fd, F_SETFL, flags & ~O_APPEND) < 0)
+    ThrowDiskError("fcntl", errno);
+
+  off_t offset = lseek(fd, 0, SEEK_CUR);
+  if (offset < 0) ThrowDiskError("lseek", errno);
+
+  // left over from an earlier transfer, anything still in flight was
+  // reaped by its Cancel
+  for (auto& b : buffers) b = Buffer();
+
+  // however the upload ends the file is left positioned, and cut, at the end
+  // of the data written without gaps, which is where the upload is resumed
+  // from and where WriteBehind releases any preallocated space. a buffer
+  // only holds less written than received while its write is outstanding
+  // or after it failed, both of which leave a gap from there on
+  auto positionGuard = util::MakeScopeExit([&]
+    {
+      off_t end = offset;
+      for (const auto& b : buffers)
+      {
+        if (b.done < b.len) end = std::min<off_t>(end, b.offset + b.done);
+      }
+      
+      Cancel();
+      
+      struct stat st;
+      if (fstat(fd, &st) == 0 && st.st_size > end) (void) ftruncate(fd, end);
+      (void) lseek(fd, end, SEEK_SET);
+    });
+
+  int socket = data.socket.Socket();
+  bool receiving = true;
+  bool eos = false;
+  unsigned writing = 0;
+
+  ArmControl(data);
+  PrepRecv(0, socket);
+  Submit();
+
+  while (!eos || writing > 0)
+  {
+    Completion c = Wait(data);
+    Buffer& b = buffers[c.tag];
+
+    if (b.op == Op::Recv)
+    {
+      b.op = Op::None;
+      receiving = false;
+      if (c.result < 0) ThrowNetworkError(-c.result);
+      if (c.result == 0) eos = true;
+      else
+      {
+        b.len = c.result;
+        b.offset = offset;
+        offset += c.result;
+        PrepWrite(c.tag, fd);
+        ++writing;
+      }
+    }
+    else
+    if (b.op == Op::Write)
+    {
+      b.op = Op::None;
+      if (c.result < 0) ThrowDiskError("write", -c.result);
+      b.done += c.result;
+      // only counted once on disk so a failed upload isn't credited for
+      // data it never stored
+      update(c.result);
+      if (b.done < b.len) PrepWrite(c.tag, fd);
+      else --writing;
+    }
+
+    // only one receive is ever in flight to preserve stream order
+    if (!receiving && !eos)
+    {
+      for (unsigned i = 0; i < bufferCount; ++i)
+      {
+        if (buffers[i].op == Op::None)
+        {
+          PrepRecv(i, socket);
+          receiving = true;
+          break;
+        }
+      }
+    }
+
+    Submit();
+  }
+
+  (void) positionGuard;
+  (void) cancelGuard;
+  throw util::net::EndOfStream();
+}
+
+} /* ftp namespace */
+
+#endif
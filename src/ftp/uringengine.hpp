@@ -0,0 +1,101 @@
+#ifndef __FTP_URINGENGINE_HPP
+#define __FTP_URINGENGINE_HPP
+
+#if defined(EBFTPD_IO_URING)
+
+#include <vector>
+#include <functional>
+#include <sys/types.h>
+#include <liburing.h>
+
+namespace ftp
+{
+
+class Data;
+
+// per thread io_uring ring keeping several disk and socket operations in
+// flight for a single binary transfer, using buffers registered with the ring
+class UringEngine
+{
+public:
+  typedef std::function<void(size_t)> UpdateFunction;
+  typedef std::function<bool()> GrowingFunction;
+
+private:
+  enum class Op
+  {
+    None,
+    Read,
+    Write,
+    Send,
+    Recv
+  };
+
+  struct Buffer
+  {
+    Op op;
+    off_t offset;
+    size_t len;
+    size_t done;
+    bool ready;
+
+    Buffer() : op(Op::None), offset(0), len(0), done(0), ready(false) { }
+  };
+
+  struct Completion
+  {
+    unsigned tag;
+    int result;
+  };
+
+  static const unsigned queueDepth = 16;
+  static const unsigned bufferCount = 4;
+  static const size_t bufferSize = 65536;
+  static const unsigned controlTag = bufferCount;
+  static const unsigned cancelTag = bufferCount + 1;
+
+  struct io_uring ring;
+  std::vector<char> memory;
+  Buffer buffers[bufferCount];
+  unsigned inflight;
+  bool controlArmed;
+
+  UringEngine();
+
+  char* BufferData(unsigned i) { return memory.data() + i * bufferSize; }
+
+  struct io_uring_sqe* GetSQE(unsigned tag);
+  void Submit();
+  Completion Wait(Data& data);
+  void ArmControl(Data& data);
+  void Cancel();
+
+  void PrepRead(unsigned i, int fd, off_t offset);
+  void PrepWrite(unsigned i, int fd);
+  void PrepSend(unsigned i, int socket);
+  void PrepRecv(unsigned i, int socket);
+
+  void DownloadPipeline(Data& data, int fd, off_t& offset, const UpdateFunction& update);
+
+public:
+  ~UringEngine();
+
+  void Download(Data& data, int fd, off_t offset, const GrowingFunction& growing,
+                const UpdateFunction& update);
+  /* Throws std::ios_base::failure, NetworkError, TransferAborted, ControlError */
+  /* and any exception thrown by update */
+
+  void Upload(Data& data, int fd, const UpdateFunction& update);
+  /* update is called as data reaches the file rather than as it's received */
+  /* Throws EndOfStream on completion */
+  /* Same exceptions as Download otherwise */
+
+  static UringEngine* Get();
+  /* Returns nullptr if io_uring is unavailable on this system */
+};
+
+} /* ftp namespace */
+
+#endif
+
+#endif
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ios>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/statvfs.h>
+#include "ftp/writebehind.hpp"
+#include "util/error.hpp"
+#include "logs/logs.hpp"
+#include "cfg/get.hpp"
+
+namespace ftp
+{
+
+WriteBehind::WriteBehind(int fd, off_t allocateSize) :
+  fd(fd),
+  offset(std::max<off_t>(0, lseek(fd, 0, SEEK_CUR))),
+  allocated(false),
+  syncStart(offset),
+  syncEnd(offset),
+  len(0),
+  finished(false)
+{
+#if defined(__linux__)
+  // clamped again here as the upload may be to another filesystem than the
+  // one ALLO was checked against
+  struct statvfs sfs;
+  if (allocateSize > 0 && fstatvfs(fd, &sfs) == 0)
+  {
+    off_t freeBytes = static_cast<off_t>(sfs.f_bavail) * sfs.f_bsize;
+    off_t reserved = static_cast<off_t>(cfg::Get().FreeSpace()) * 1024;
+    allocateSize = std::min(allocateSize, std::max<off_t>(0, freeBytes - reserved));
+  }
+  
+  // size is kept so incomplete downloads never see the unwritten space
+  if (allocateSize > 0)
+  {
+    // a failed fallocate may still have reserved some blocks, so they're
+    // released at the end either way
+    allocated = true;
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, allocateSize) < 0)
+    {
+      logs::Debug("Unable to preallocate %1% bytes for upload: %2%", 
+                  allocateSize, util::ErrnoToMessage(errno));
+    }
+  }
+#else
+  (void) allocateSize;
+#endif
+}
+
+WriteBehind::~WriteBehind()
+{
+  if (!finished)
+  {
+    try
+    {
+      Finish();
+    }
+    catch (const std::ios_base::failure& e)
+    {
+      logs::Error("Error while finishing upload writes: %1%", e.what());
+    }
+  }
+}
+
+void WriteBehind::Write(const char* data, size_t len)
+{
+  if (buffer.empty()) buffer.resize(chunkSize);
+  
+  while (len > 0)
+  {
+    // first chunk only fills up to the next boundary, resumed uploads
+    // rarely start on one
+    size_t target = chunkSize - offset % chunkSize;
+    size_t copyLen = std::min(len, target - this->len);
+    std::memcpy(buffer.data() + this->len, data, copyLen);
+    this->len += copyLen;
+    data += copyLen;
+    len -= copyLen;
+    
+    if (this->len == target) Flush();
+  }
+}
+
+void WriteBehind::Flush()
+{
+  size_t done = 0;
+  while (done < len)
+  {
+    ssize_t result = write(fd, buffer.data() + done, len - done);
+    if (result < 0)
+    {
+      if (errno == EINTR) continue;
+      throw std::ios_base::failure("write: " + util::ErrnoToMessage(errno));
+    }
+    done += result;
+  }
+  
+  offset += len;
+  len = 0;
+  Writeback();
+}
+
+void WriteBehind::Advance(size_t len)
+{
+  offset += len;
+  Writeback();
+}
+
+void WriteBehind::Writeback()
+{
+#if defined(__linux__)
+  if (offset - syncEnd < static_cast<off_t>(chunkSize)) return;
+  
+  // start writeback of the latest chunk and wait on the one before it, so
+  // each upload holds at most a couple of chunks of dirty pages
+  (void) sync_file_range(fd, syncEnd, offset - syncEnd, SYNC_FILE_RANGE_WRITE);
+  if (syncEnd > syncStart)
+  {
+    (void) sync_file_range(fd, syncStart, syncEnd - syncStart, 
+                           SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | 
+                           SYNC_FILE_RANGE_WAIT_AFTER);
+  }
+  
+  syncStart = syncEnd;
+  syncEnd = offset;
+#endif
+}
+
+void WriteBehind::Finish()
+{
+  finished = true;
+  if (len > 0) Flush();
+  
+  if (allocated)
+  {
+    // data may also have been written directly to the file, so the file
+    // position is what tells us where the upload really ended
+    off_t end = lseek(fd, 0, SEEK_CUR);
+    if (end < 0) throw std::ios_base::failure("lseek: " + util::ErrnoToMessage(errno));
+    if (ftruncate(fd, end) < 0)
+      throw std::ios_base::failure("ftruncate: " + util::ErrnoToMessage(errno));
+    allocated = false;
+  }
+}
+
+} /* ftp namespace */
@@ -0,0 +1,48 @@
+#ifndef __FTP_WRITEBEHIND_HPP
+#define __FTP_WRITEBEHIND_HPP
+
+#include <vector>
+#include <sys/types.h>
+
+namespace ftp
+{
+
+// upload side counterpart to ReadAhead, preallocates the expected size,
+// coalesces small writes into large chunks aligned on chunk boundaries and
+// paces writeback of each completed chunk rather than leaving the kernel to
+// flush a large backlog of dirty pages at once
+class WriteBehind
+{
+  int fd;
+  off_t offset;
+  bool allocated;
+  off_t syncStart;
+  off_t syncEnd;
+  std::vector<char> buffer;
+  size_t len;
+  bool finished;
+
+  static const size_t chunkSize = 1048576;
+
+  void Flush();
+  void Writeback();
+
+public:
+  WriteBehind(int fd, off_t allocateSize);
+  /* allocateSize of 0 skips preallocation */
+  ~WriteBehind();
+
+  void Write(const char* data, size_t len);
+  /* Throws std::ios_base::failure */
+
+  void Advance(size_t len);
+  /* For data written to fd directly, No exceptions */
+
+  void Finish();
+  /* Writes out any buffered data and releases unused preallocated space */
+  /* Throws std::ios_base::failure */
+};
+
+} /* ftp namespace */
+
+#endif
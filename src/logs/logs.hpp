@@ -116,13 +116,15 @@ void Error(const std::string& format, const Args&... args)
 inline void Transfer(const std::string& path, const std::string& direction, 
       const std::string& username, const std::string& groupname, 
       double startTime, long long kBytes, double xfertime, 
-      bool okay, const std::string& section)
+      bool okay, long long bufferSize, const std::string& bufferMode,
+      int socketBuffer, const std::string& section)
 {
   extern Logger transfer;
   transfer.PushEntry(QuoteOn(), "epoch start", startTime, "direction", direction,
                      "username", username, "groupname", groupname,
                      "size", kBytes, "seconds", xfertime, "okay", okay ? "okay" : "fail",
-                     "section", section, "path", path);
+                     "buffer", bufferSize, "buffer mode", bufferMode,
+                     "socket buffer", socketBuffer, "section", section, "path", path);
 }
 
 void InitialisePreConfig();
@@ -189,7 +189,9 @@ int main(int argc, char** argv)
       {
         logs::Debug("Initialising TLS context..");
         util::net::TLSServerContext::Initialise(
-            cfg::Get().TlsCertificate(), cfg::Get().TlsCiphers());
+            cfg::Get().TlsCertificate(), cfg::Get().TlsCiphers(),
+            cfg::Get().TlsSessionCacheSize(), cfg::Get().TlsSessionTimeout(),
+            cfg::Get().TlsTicketRotation());
         util::net::TLSClientContext::Initialise(
             cfg::Get().TlsCertificate(), cfg::Get().TlsCiphers());
       }
@@ -0,0 +1,181 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ftp/counter.hpp"
+
+// 64 threads hammering Start / Stop on a TransferCounter, timed against the
+// single mutex counter it replaced, then checked to never let more transfers
+// run than the personal and global limits allow
+
+namespace
+{
+
+const int numThreads = 64;
+const int numUsers = 20;
+const int personalLimit = 4;
+const int globalLimit = 32;
+
+// the counter as it was before sharding, one lock around everything
+class MutexCounter
+{
+  std::mutex mutex;
+  std::unordered_map<acl::UserID, int> personal;
+  int global;
+
+public:
+  MutexCounter() : global(0) { }
+
+  ftp::CounterResult Start(acl::UserID uid, int limit, bool exempt)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    int& count = personal[uid];
+    if (count >= limit && limit != -1) return ftp::CounterResult::PersonalFail;
+    if (!exempt && global >= globalLimit) return ftp::CounterResult::GlobalFail;
+    ++count;
+    ++global;
+    return ftp::CounterResult::Okay;
+  }
+
+  void Stop(acl::UserID uid)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    --personal[uid];
+    --global;
+  }
+};
+
+struct Result
+{
+  long long milliseconds;
+  long long okay;
+  long long personalFails;
+  long long globalFails;
+  bool overLimit;
+};
+
+template <typename Counter>
+Result Run(Counter& counter, int iterations, bool check)
+{
+  // each thread keeps up to held transfers running so the limits are
+  // actually reached, checking them is done in a separate run as the shared
+  // counts it needs would otherwise dominate the timing
+  const size_t held = 2;
+  std::vector<std::atomic<int>> active(numUsers);
+  for (auto& a : active) a = 0;
+  std::atomic<int> activeGlobal(0);
+  std::atomic<long long> okay(0);
+  std::atomic<long long> personalFails(0);
+  std::atomic<long long> globalFails(0);
+  std::atomic<bool> overLimit(false);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; ++t)
+  {
+    threads.emplace_back([&, t]()
+    {
+      acl::UserID uid = t % numUsers;
+      size_t running = 0;
+      long long threadOkay = 0, threadPersonalFails = 0, threadGlobalFails = 0;
+      for (int i = 0; i < iterations; ++i)
+      {
+        if (running == held)
+        {
+          if (check)
+          {
+            --activeGlobal;
+            --active[uid];
+          }
+          counter.Stop(uid);
+          --running;
+        }
+        
+        switch (counter.Start(uid, personalLimit, false))
+        {
+          case ftp::CounterResult::Okay         :
+            if (check && (++active[uid] > personalLimit || ++activeGlobal > globalLimit))
+              overLimit = true;
+            ++running;
+            ++threadOkay;
+            break;
+          case ftp::CounterResult::PersonalFail :
+            ++threadPersonalFails;
+            break;
+          case ftp::CounterResult::GlobalFail   :
+            ++threadGlobalFails;
+            break;
+        }
+      }
+      
+      while (running-- > 0)
+      {
+        if (check)
+        {
+          --activeGlobal;
+          --active[uid];
+        }
+        counter.Stop(uid);
+      }
+      
+      okay += threadOkay;
+      personalFails += threadPersonalFails;
+      globalFails += threadGlobalFails;
+    });
+  }
+
+  for (auto& thread : threads) thread.join();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  Result result;
+  result.milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+  result.okay = okay;
+  result.personalFails = personalFails;
+  result.globalFails = globalFails;
+  result.overLimit = overLimit;
+  return result;
+}
+
+void Display(const std::string& name, const Result& result, int iterations)
+{
+  long long ops = static_cast<long long>(numThreads) * iterations;
+  std::cout << name << ": " << result.milliseconds << "ms, "
+            << (result.milliseconds > 0 ? ops * 1000 / result.milliseconds : ops) << " starts/s, "
+            << result.okay << " okay, " << result.personalFails << " personal fails, "
+            << result.globalFails << " global fails"
+            << (result.overLimit ? ", LIMIT EXCEEDED" : "") << std::endl;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  int iterations = argc > 1 ? std::atoi(argv[1]) : 100000;
+  if (iterations <= 0)
+  {
+    std::cerr << "usage: " << argv[0] << " [iterations per thread]" << std::endl;
+    return 1;
+  }
+
+  MutexCounter mutexCounter;
+  Result before = Run(mutexCounter, iterations, false);
+  Display("single mutex", before, iterations);
+
+  ftp::TransferCounter transferCounter([]() { return globalLimit; });
+  Result after = Run(transferCounter, iterations, false);
+  Display("sharded     ", after, iterations);
+
+  // must never exceed the limits and end with nothing counted
+  Result checked = Run(transferCounter, iterations / 10 + 1, true);
+  Display("checked     ", checked, iterations / 10 + 1);
+  ftp::CounterResult result = transferCounter.Start(0, 1, false);
+  bool leaked = result != ftp::CounterResult::Okay;
+  if (!leaked) transferCounter.Stop(0);
+  if (leaked) std::cout << "counts left over after all transfers stopped" << std::endl;
+  
+  return checked.overLimit || leaked ? 1 : 0;
+}
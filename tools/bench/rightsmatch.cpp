@@ -0,0 +1,161 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/algorithm/string/replace.hpp>
+#include "cfg/setting.hpp"
+#include "util/string.hpp"
+
+// random path rights checked against random paths with cfg::Rights and with
+// the linear evaluator it replaced, which must agree on the first matching
+// right for every path, along with the time each took
+
+namespace
+{
+
+const char* ruleSegments[] =
+{
+  "site", "incoming", "pre", "groups", "a", "b", "x.y", "*", "?", "[ab]",
+  "*.nfo", "c\\*", "[:username:]", "[:groupname:]", "bob*", "s*", "?re",
+  "[gi]*"
+};
+
+const char* pathSegments[] =
+{
+  "site", "incoming", "pre", "groups", "a", "b", "x.y", "c*", "zz.nfo",
+  "a.nfo", "bob", "bobby", "[:groupname:]"
+};
+
+template <typename T, size_t N>
+size_t Count(T (&)[N]) { return N; }
+
+// acl::path::Evaluate's loop before rights were precompiled, the primary
+// group is only substituted when the user has one
+int OldMatch(const std::vector<std::string>& rules, const std::string& path,
+             const std::string& username, const std::string& group)
+{
+  for (size_t i = 0; i < rules.size(); ++i)
+  {
+    std::string pattern(rules[i]);
+    if (pattern.find("[:username:]") != std::string::npos ||
+        pattern.find("[:groupname:]") != std::string::npos)
+    {
+      boost::replace_all(pattern, "[:username:]", username);
+      if (!group.empty()) boost::replace_all(pattern, "[:groupname:]", group);
+    }
+
+    if (util::WildcardMatch(pattern, path)) return i;
+  }
+  return -1;
+}
+
+int NewMatch(const cfg::Rights& rights, const std::string& path,
+             const std::string& username, const std::string& group)
+{
+  const cfg::Right* right = rights.Match(path, username, [&group]() { return group; });
+  return right ? static_cast<int>(right - &*rights.begin()) : -1;
+}
+
+template <typename Function>
+long long Time(Function function)
+{
+  auto start = std::chrono::steady_clock::now();
+  function();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  int numRules = argc > 1 ? std::atoi(argv[1]) : 200;
+  int numPaths = argc > 2 ? std::atoi(argv[2]) : 20000;
+  unsigned seed = argc > 3 ? std::atoi(argv[3]) : 1;
+  if (numRules <= 0 || numPaths <= 0)
+  {
+    std::cerr << "usage: " << argv[0] << " [rules] [paths] [seed]" << std::endl;
+    return 1;
+  }
+
+  std::mt19937 random(seed);
+  auto pick = [&random](int n) { return static_cast<int>(random() % n); };
+
+  std::vector<std::string> rules;
+  cfg::Rights rights;
+  for (int i = 0; i < numRules; ++i)
+  {
+    // mostly under a literal top level directory as real rights are, so
+    // the index has something to narrow, a leading /* would match all
+    int top;
+    do top = pick(8) ? pick(4) : pick(Count(ruleSegments));
+    while (std::string(ruleSegments[top]) == "*");
+    
+    std::string rule = std::string("/") + ruleSegments[top];
+    for (int j = pick(4); j > 0; --j)
+      rule += std::string("/") + ruleSegments[pick(Count(ruleSegments))];
+    if (pick(3) == 0) rule += "/*";
+
+    rules.emplace_back(rule);
+    rights.emplace_back(std::vector<std::string> { rule, "*" });
+  }
+
+  std::vector<std::string> paths { "/" };
+  for (int i = 0; i < numPaths; ++i)
+  {
+    std::string path;
+    for (int j = pick(5); j >= 0; --j)
+      path += std::string("/") + pathSegments[pick(Count(pathSegments))];
+    paths.emplace_back(path);
+  }
+
+  // users with and without a primary group, the special variable is left
+  // in the pattern by both evaluators when there's none
+  const std::string username("bob");
+  const std::vector<std::string> groups { "", "pre" };
+
+  int mismatches = 0;
+  int matched = 0;
+  for (const auto& group : groups)
+  {
+    for (const auto& path : paths)
+    {
+      int before = OldMatch(rules, path, username, group);
+      int after = NewMatch(rights, path, username, group);
+      if (before != after)
+      {
+        if (++mismatches <= 10)
+          std::cout << "mismatch on " << path << " with group '" << group << "': "
+                    << (before == -1 ? "none" : rules[before]) << " before, "
+                    << (after == -1 ? "none" : rules[after]) << " after" << std::endl;
+      }
+      if (after != -1) ++matched;
+    }
+  }
+
+  const int rounds = 20;
+  long long total = 0;
+  long long oldTime = Time([&]()
+  {
+    for (int i = 0; i < rounds; ++i)
+      for (const auto& path : paths)
+        total += OldMatch(rules, path, username, groups.back());
+  });
+
+  long long newTime = Time([&]()
+  {
+    for (int i = 0; i < rounds; ++i)
+      for (const auto& path : paths)
+        total += NewMatch(rights, path, username, groups.back());
+  });
+
+  std::cout << paths.size() * groups.size() << " checks of " << paths.size()
+            << " paths against " << rules.size() << " rules, "
+            << matched << " matched, " << mismatches << " mismatches" << std::endl;
+  std::cout << "linear: " << oldTime << "ms, indexed: " << newTime << "ms"
+            << " (" << rounds << " rounds, checksum " << total << ")" << std::endl;
+
+  return mismatches > 0 ? 1 : 0;
+}
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "util/net/tcplistener.hpp"
+#include "util/net/tcpsocket.hpp"
+#include "util/net/tlscontext.hpp"
+#include "util/net/error.hpp"
+
+// the same amount of data sent over loopback TLS with OpenSSL doing the
+// encryption and with it offloaded to the kernel, reporting the throughput
+// and the cpu time the sending side used for each
+
+namespace
+{
+
+const size_t bufferSize = 65536;
+
+enum class Mode { OpenSSL, KernelWrite, KernelSendFile };
+
+struct Result
+{
+  bool kernelTLS;
+  long long bytes;
+  double seconds;
+  double cpuSeconds;
+};
+
+double ThreadCPUSeconds()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+}
+
+// the receiving side runs in its own thread, always decrypting with OpenSSL
+void Receive(const util::net::Endpoint& endpoint, long long& received)
+{
+  try
+  {
+    util::net::TCPSocket socket(endpoint);
+    socket.HandshakeTLS(util::net::TLSSocket::Client);
+    std::vector<char> buffer(bufferSize);
+    while (true) received += socket.Read(buffer.data(), buffer.size());
+  }
+  catch (const util::net::EndOfStream&)
+  {
+  }
+  catch (const util::net::NetworkError& e)
+  {
+    std::cerr << "receive failed: " << e.Message() << std::endl;
+  }
+}
+
+Result Run(Mode mode, long long total, int fd, off_t fileSize)
+{
+  util::net::TCPListener listener(util::net::Endpoint("127.0.0.1", 0));
+  long long received = 0;
+  std::thread receiver(Receive, listener.Endpoint(), std::ref(received));
+
+  util::net::TCPSocket socket;
+  Result result;
+  std::chrono::steady_clock::time_point start;
+  try
+  {
+    socket.Accept(listener);
+    socket.HandshakeTLS(util::net::TLSSocket::Server, mode != Mode::OpenSSL);
+    result.kernelTLS = socket.IsKernelTLS();
+
+    std::vector<char> buffer(bufferSize, 'x');
+    start = std::chrono::steady_clock::now();
+    double cpuStart = ThreadCPUSeconds();
+    long long sent = 0;
+    while (sent < total)
+    {
+      if (mode == Mode::KernelSendFile && result.kernelTLS)
+      {
+        off_t offset = sent % fileSize;
+        size_t count = std::min<long long>(total - sent, fileSize - offset);
+        sent += socket.SendFile(fd, offset, count);
+      }
+      else
+      {
+        size_t len = std::min<long long>(total - sent, buffer.size());
+        socket.Write(buffer.data(), len);
+        sent += len;
+      }
+    }
+    socket.Close();
+    result.cpuSeconds = ThreadCPUSeconds() - cpuStart;
+  }
+  catch (...)
+  {
+    socket.Close();
+    receiver.join();
+    throw;
+  }
+  receiver.join();
+
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  result.seconds = std::chrono::duration<double>(elapsed).count();
+  result.bytes = received;
+  return result;
+}
+
+void Display(const std::string& name, const Result& result, long long total)
+{
+  double megabytes = result.bytes / 1048576.0;
+  std::cout << name << ": " << static_cast<long long>(megabytes / result.seconds)
+            << " MB/s, sender cpu " << result.cpuSeconds << "s"
+            << (result.kernelTLS ? "" : ", openssl")
+            << (result.bytes != total ? ", SHORT READ" : "") << std::endl;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    std::cerr << "usage: " << argv[0] << " <certificate> [megabytes] [file]" << std::endl;
+    return 1;
+  }
+
+  long long megabytes = argc > 2 ? std::atoll(argv[2]) : 1024;
+  if (megabytes <= 0)
+  {
+    std::cerr << "usage: " << argv[0] << " <certificate> [megabytes] [file]" << std::endl;
+    return 1;
+  }
+  long long total = megabytes * 1048576;
+
+  // sendfile reads from a file, it's sent repeatedly until total is reached
+  // so it stays in the page cache, a temporary one is made if none is given
+  std::string path = argc > 3 ? argv[3] : "/tmp/tlsthroughput.XXXXXX";
+  int fd;
+  if (argc > 3)
+    fd = open(path.c_str(), O_RDONLY);
+  else
+  {
+    fd = mkstemp(&path[0]);
+    if (fd >= 0)
+    {
+      unlink(path.c_str());
+      std::vector<char> buffer(bufferSize, 'x');
+      for (int i = 0; i < 1024; ++i)
+        if (write(fd, buffer.data(), buffer.size()) != static_cast<ssize_t>(buffer.size()))
+        {
+          close(fd);
+          fd = -1;
+          break;
+        }
+    }
+  }
+
+  off_t fileSize = fd >= 0 ? lseek(fd, 0, SEEK_END) : -1;
+  if (fileSize <= 0)
+  {
+    std::cerr << "unable to open " << path << std::endl;
+    return 1;
+  }
+
+  try
+  {
+    util::net::TLSServerContext::Initialise(argv[1]);
+    util::net::TLSClientContext::Initialise();
+
+    Result openssl = Run(Mode::OpenSSL, total, fd, fileSize);
+    Display("openssl write", openssl, total);
+    Result kernelWrite = Run(Mode::KernelWrite, total, fd, fileSize);
+    Display("ktls write   ", kernelWrite, total);
+    Result kernelSendFile = Run(Mode::KernelSendFile, total, fd, fileSize);
+    Display("ktls sendfile", kernelSendFile, total);
+
+    if (!kernelWrite.kernelTLS)
+      std::cout << "kernel tls unavailable, check the tls module is loaded "
+                   "and the cipher is supported" << std::endl;
+
+    close(fd);
+    return openssl.bytes != total || kernelWrite.bytes != total ||
+           kernelSendFile.bytes != total ? 1 : 0;
+  }
+  catch (const util::net::NetworkError& e)
+  {
+    std::cerr << "failed: " << e.Message() << std::endl;
+  }
+
+  close(fd);
+  return 1;
+}
@@ -3,7 +3,6 @@
 
 #include <memory>
 #include <algorithm>
-#include <cassert>
 #include <string>
 #include <cstdint>
 #include <array>
@@ -104,12 +103,14 @@ public:
   
   void Update(const uint8_t* bytes, unsigned len)
   {
-    assert(len <= (*writeIt)->data.size());
-    
     {
       std::unique_lock<std::mutex> lock(mutex);
       while (!(*writeIt)->empty) writeCond.wait(lock);
     }
+    
+    // empty buffers aren't touched by the checksum thread, grown here when
+    // the chunks passed grow rather than all allocated at the largest
+    if (len > (*writeIt)->data.size()) (*writeIt)->data.resize(len);
 
     std::copy(&bytes[0], &bytes[len], (*writeIt)->data.begin());
 
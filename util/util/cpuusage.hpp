@@ -0,0 +1,51 @@
+#ifndef __UTIL_CPUUSAGE_HPP
+#define __UTIL_CPUUSAGE_HPP
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+namespace util
+{
+
+// cpu time consumed by the calling thread since construction or Reset,
+// falls back to the whole process where per thread usage is unavailable
+class CPUUsage
+{
+  struct rusage start;
+
+  static void Sample(struct rusage& usage)
+  {
+#if defined(RUSAGE_THREAD)
+    if (getrusage(RUSAGE_THREAD, &usage) == 0) return;
+#endif
+    (void) getrusage(RUSAGE_SELF, &usage);
+  }
+
+  static double Seconds(const struct timeval& end, const struct timeval& start)
+  {
+    return (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+  }
+
+public:
+  CPUUsage() { Reset(); }
+
+  void Reset() { Sample(start); }
+
+  double User() const
+  {
+    struct rusage now;
+    Sample(now);
+    return Seconds(now.ru_utime, start.ru_utime);
+  }
+
+  double System() const
+  {
+    struct rusage now;
+    Sample(now);
+    return Seconds(now.ru_stime, start.ru_stime);
+  }
+};
+
+} /* util namespace */
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef __UTIL_HISTOGRAM_HPP
+#define __UTIL_HISTOGRAM_HPP
+
+#include <atomic>
+#include <string>
+#include <sstream>
+
+namespace util
+{
+
+// lock free histogram of microsecond durations in power of two buckets,
+// the first covering up to 64us and the last everything over 4s
+class Histogram
+{
+  static const int numBuckets = 18;
+  static const int firstShift = 6;
+
+  std::atomic<unsigned long long> buckets[numBuckets];
+  std::atomic<unsigned long long> total;
+  std::atomic<long long> maximum;
+
+  static std::string Label(long long microseconds)
+  {
+    std::ostringstream os;
+    if (microseconds < 1000) os << microseconds << "us";
+    else if (microseconds < 1000000) os << microseconds / 1000 << "ms";
+    else os << microseconds / 1000000 << "s";
+    return os.str();
+  }
+
+public:
+  Histogram() : total(0), maximum(0)
+  {
+    for (auto& bucket : buckets) bucket = 0;
+  }
+
+  void Record(long long microseconds)
+  {
+    int i = 0;
+    while (i < numBuckets - 1 && microseconds >= (1LL << (firstShift + i))) ++i;
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+
+    long long max = maximum.load(std::memory_order_relaxed);
+    while (microseconds > max &&
+           !maximum.compare_exchange_weak(max, microseconds, std::memory_order_relaxed));
+  }
+
+  unsigned long long Count() const { return total; }
+  long long Maximum() const { return maximum; }
+
+  std::string ToString() const
+  {
+    std::ostringstream os;
+    os << "count " << total << ", max " << Label(maximum);
+    for (int i = 0; i < numBuckets; ++i)
+    {
+      unsigned long long count = buckets[i];
+      if (count == 0) continue;
+      if (i == numBuckets - 1) os << ", >" << Label(1LL << (firstShift + i - 1));
+      else os << ", <" << Label(1LL << (firstShift + i));
+      os << " " << count;
+    }
+    return os.str();
+  }
+};
+
+} /* util namespace */
+
+#endif
@@ -4,6 +4,7 @@
 #include <cassert>
 #include <iterator>
 #include <cstdint>
+#include <stdexcept>
 #include <unordered_map>
 
 namespace util
@@ -22,7 +23,7 @@ class LRUCache
   EntriesMap entries;
   Entry* first;
   Entry* last;
-  uint16_t capacity;
+  size_t capacity;
   
   struct Entry
   {
@@ -33,6 +34,16 @@ class LRUCache
     
     Entry(LRUCache& cache, const KeyType& key, const ValueType& value) :
       cache(cache), pair(std::make_pair(key, value)), next(nullptr), prev(nullptr)
+    {
+      Link();
+    }
+    
+    ~Entry()
+    {
+      Unlink();
+    }
+    
+    void Link()
     {
       Entry* temp = cache.first;
       cache.first = this;
@@ -41,12 +52,20 @@ class LRUCache
       if (!cache.first->next) cache.last = cache.first;
     }
     
-    ~Entry()
+    void Unlink()
     {
       if (next) next->prev = prev;
       if (prev) prev->next = next;
       if (this == cache.first) cache.first = next;
       if (this == cache.last) cache.last = prev;
+      next = prev = nullptr;
+    }
+    
+    void MoveToFront()
+    {
+      if (this == cache.first) return;
+      Unlink();
+      Link();
     }
   };
   
@@ -133,7 +152,7 @@ public:
     const std::pair<KeyType, ValueType>* operator->() const { return &entry->pair; }
   };
 
-  LRUCache(uint16_t capacity) :
+  LRUCache(size_t capacity) :
     first(nullptr), last(nullptr), capacity(capacity)
   {
     if (!capacity) throw std::logic_error("Capacity must be larger than zero");
@@ -141,16 +160,13 @@ public:
   
   ~LRUCache()
   {
-    while (!entries.empty())
-    {
-      delete entries.begin()->second;
-      entries.erase(entries.begin());
-    }
+    Clear();
   }
   
+  // does not count as a use
   const ValueType& Lookup(const KeyType& key) const
   {
-    typename EntriesMap::iterator it = entries.find(key);
+    typename EntriesMap::const_iterator it = entries.find(key);
     if (it == entries.end()) throw std::out_of_range("Key not in cache");
     return it->second->pair.second;
   }
@@ -159,11 +175,20 @@ public:
   {
     typename EntriesMap::iterator it = entries.find(key);
     if (it == entries.end()) throw std::out_of_range("Key not in cache");
+    it->second->MoveToFront();
     return it->second->pair.second;
   }
   
   void Insert(const KeyType& key, const ValueType& value)
   {
+    typename EntriesMap::iterator it = entries.find(key);
+    if (it != entries.end())
+    {
+      it->second->pair.second = value;
+      it->second->MoveToFront();
+      return;
+    }
+    
     while (entries.size() >= capacity) EraseOldest();
     entries.insert(std::make_pair(key, new Entry(*this, key, value)));
   }
@@ -172,9 +197,22 @@ public:
   {
     typename EntriesMap::iterator it = entries.find(key);
     if (it == entries.end()) throw std::out_of_range("Key not in cache");    
+    delete it->second;
     entries.erase(it);
   }
   
+  void Clear()
+  {
+    while (!entries.empty())
+    {
+      delete entries.begin()->second;
+      entries.erase(entries.begin());
+    }
+  }
+  
+  size_type Size() const { return entries.size(); }
+  size_t Capacity() const { return capacity; }
+  
   iterator begin() { return iterator(first); }
   iterator end() { return iterator(nullptr); }
   const_iterator begin() const { return const_iterator(first); }
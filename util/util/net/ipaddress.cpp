@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring>
 #include <sys/types.h>
 #include <arpa/inet.h>
@@ -113,6 +114,20 @@ IPAddress IPAddress::ToUnmappedv4() const
   return IPAddress(&data.unmapped.in4, sizeof(data.unmapped.in4));
 }
 
+IPAddress IPAddress::Masked(int prefixLen) const
+{
+  if (IsMappedv4()) return ToUnmappedv4().Masked(prefixLen);
+  
+  IPAddress masked(*this);
+  masked.asString.clear();
+  unsigned char* bytes = reinterpret_cast<unsigned char*>(&masked.data);
+  for (int bit = std::max(prefixLen, 0); bit < static_cast<int>(dataLen) * 8; ++bit)
+  {
+    bytes[bit / 8] &= ~(0x80 >> (bit % 8));
+  }
+  return masked;
+}
+
 bool IPAddress::Validv6(const std::string& addr)
 {
   try
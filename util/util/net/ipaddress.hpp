@@ -73,6 +73,10 @@ public:
   
   IPAddress ToUnmappedv4() const;
   
+  IPAddress Masked(int prefixLen) const;
+  /* Network address for given prefix length, mapped v4 addresses are */
+  /* unmapped first, No exceptions */
+  
   const void* Addr() const { return static_cast<const void*>(&data); }
   /* No exceptions */
 
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <cerrno>
+#include <fcntl.h>
 #include <sys/time.h>
 #include <boost/thread/thread.hpp>
 #include "util/net/tcplistener.hpp"
@@ -18,14 +19,16 @@ TCPListener::~TCPListener()
 TCPListener::TCPListener(const util::net::Endpoint& endpoint, int backlog) :
   endpoint(endpoint),
   socket(-1),
-  backlog(backlog)
+  backlog(backlog),
+  reusePort(false)
 {
   Listen();
 }
 
 TCPListener::TCPListener(int backlog) :
   socket(-1),
-  backlog(backlog)
+  backlog(backlog),
+  reusePort(false)
 {
 }
 
@@ -39,6 +42,14 @@ void TCPListener::Listen()
 
   int optVal = 1;
   setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &optVal, sizeof(optVal));
+  
+#if defined(SO_REUSEPORT)
+  if (reusePort && setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, &optVal, sizeof(optVal)) < 0)
+  {
+    int errno_ = errno;
+    throw util::net::NetworkSystemError(errno_);
+  }
+#endif
 
   socklen_t addrLen = endpoint.Length();
   struct sockaddr_storage addrStor;
@@ -81,6 +92,62 @@ void TCPListener::Accept(TCPSocket& socket)
   socket.Accept(*this);
 }
 
+int TCPListener::AcceptSocket(util::net::Endpoint& remoteEndpoint)
+{
+  assert(this->socket >= 0);
+  struct sockaddr_storage addrStor;
+  socklen_t addrLen = sizeof(addrStor);
+  struct sockaddr* addr = reinterpret_cast<struct sockaddr*>(&addrStor);
+
+  int socket;
+#if defined(__linux__)
+  // accepted sockets don't inherit the listener's O_NONBLOCK on linux
+  while ((socket = accept4(this->socket, addr, &addrLen, SOCK_CLOEXEC)) < 0)
+#else
+  while ((socket = accept(this->socket, addr, &addrLen)) < 0)
+#endif
+  {
+    boost::this_thread::interruption_point();
+    if (errno != EINTR)
+    {
+      if (errno == EWOULDBLOCK || errno == EAGAIN || errno == ETIMEDOUT)
+        throw TimeoutError();
+      else
+        throw NetworkSystemError(errno);
+    }
+  }
+  
+  remoteEndpoint = util::net::Endpoint(*addr, addrLen);
+  return socket;
+}
+
+void TCPListener::SetBlocking(bool blocking)
+{
+  int flags = fcntl(socket, F_GETFL);
+  if (flags < 0) throw NetworkSystemError(errno);
+  flags = blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK;
+  if (fcntl(socket, F_SETFL, flags) < 0) throw NetworkSystemError(errno);
+}
+
+void TCPListener::SetBufferSize(int size)
+{
+  if (setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) < 0 ||
+      setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0)
+    throw NetworkSystemError(errno);
+}
+
+void TCPListener::Swap(TCPListener& other)
+{
+  if (&other == this) return;
+  std::lock(socketMutex, other.socketMutex);
+  std::lock_guard<std::mutex> lock(socketMutex, std::adopt_lock);
+  std::lock_guard<std::mutex> otherLock(other.socketMutex, std::adopt_lock);
+  std::swap(endpoint, other.endpoint);
+  std::swap(socket, other.socket);
+  std::swap(backlog, other.backlog);
+  std::swap(reusePort, other.reusePort);
+}
+
 void TCPListener::Shutdown()
 {
   std::lock_guard<std::mutex> lock(socketMutex);
@@ -18,6 +18,7 @@ class TCPListener : boost::noncopyable
   std::mutex socketMutex;
   int socket;
   int backlog;
+  bool reusePort;
 
   TCPListener(const TCPListener&) = delete;
   TCPListener& operator=(const TCPListener&) = delete;
@@ -40,6 +41,26 @@ public:
   
   void Accept(TCPSocket& socket);
   /* Throws NetworkSystemError, InvalidIPAddressError */
+  /* Throws TimeoutError when non-blocking and no connection is pending */
+  
+  int AcceptSocket(util::net::Endpoint& remoteEndpoint);
+  /* Returns the raw accepted socket for callers that may refuse it */
+  /* before committing to a TCPSocket, caller must close or adopt it */
+  /* Throws NetworkSystemError, TimeoutError */
+  
+  void SetReusePort(bool reusePort) { this->reusePort = reusePort; }
+  /* Takes effect on next Listen, No exceptions */
+  
+  void SetBlocking(bool blocking);
+  /* Throws NetworkSystemError */
+  
+  void SetBufferSize(int size);
+  /* Sets SO_SNDBUF / SO_RCVBUF inherited by accepted sockets, must be */
+  /* set before the connection arrives to affect the window scale */
+  /* Throws NetworkSystemError */
+  
+  void Swap(TCPListener& other);
+  /* Exchanges sockets and endpoints, No exceptions */
   
   void Close();
   /* No exceptions */
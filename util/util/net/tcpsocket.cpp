@@ -1,4 +1,11 @@
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+#include <fcntl.h>
 #include <sys/socket.h>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
 #include <boost/thread/thread.hpp>
 #include "util/net/tcpsocket.hpp"
 #include "util/net/tcplistener.hpp"
@@ -67,7 +74,8 @@ void TCPSocket::PopulateRemoteEndpoint(int socket)
   remoteEndpoint = Endpoint(*remoteAddr, remoteLen);
 }
 
-void TCPSocket::Connect(const Endpoint& remoteEndpoint, const Endpoint* localEndpoint)
+void TCPSocket::Connect(const Endpoint& remoteEndpoint, const Endpoint* localEndpoint,
+                        int bufferSize)
 {
   assert(socket < 0);
   int socket = ::socket(static_cast<int>(remoteEndpoint.Family()), SOCK_STREAM, 0);
@@ -80,6 +88,11 @@ void TCPSocket::Connect(const Endpoint& remoteEndpoint, const Endpoint* localEnd
 
   SetTimeout(socket);
   
+  if (bufferSize > 0 &&
+      (setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize)) < 0 ||
+       setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize)) < 0))
+    throw NetworkSystemError(errno);
+  
   if (localEndpoint)
   {
     socklen_t addrLen = localEndpoint->Length();
@@ -117,34 +130,29 @@ void TCPSocket::Connect(const Endpoint& remoteEndpoint, const Endpoint* localEnd
 
 void TCPSocket::Connect(const Endpoint& endpoint)
 {
-  Connect(endpoint, nullptr);
+  Connect(endpoint, nullptr, 0);
 }
 
 void TCPSocket::Connect(const Endpoint& remoteEndpoint, 
                         const Endpoint& localEndpoint)
 {
-  Connect(remoteEndpoint, &localEndpoint);
+  Connect(remoteEndpoint, &localEndpoint, 0);
+}
+
+void TCPSocket::Connect(const Endpoint& remoteEndpoint, 
+                        const Endpoint& localEndpoint, int bufferSize)
+{
+  Connect(remoteEndpoint, &localEndpoint, bufferSize);
 }
 
 void TCPSocket::Accept(TCPListener& listener)
 {
-  struct sockaddr_storage addrStor;
-  socklen_t addrLen = sizeof(addrStor);
-  struct sockaddr* addr = reinterpret_cast<struct sockaddr*>(&addrStor);
+  Endpoint remoteEndpoint;
+  Accept(listener.AcceptSocket(remoteEndpoint));
+}
 
-  int socket;
-  while ((socket = accept(listener.Socket(), addr, &addrLen)) < 0)
-  {
-    boost::this_thread::interruption_point();
-    if (errno != EINTR)
-    {
-      if (errno == EWOULDBLOCK || errno == EAGAIN || errno == ETIMEDOUT)
-        throw TimeoutError();
-      else
-        throw NetworkSystemError(errno);
-    }
-  }
-  
+void TCPSocket::Accept(int socket)
+{
   auto socketGuard = util::MakeScopeError([&socket]() { close(socket); }); (void) socketGuard;
   
   boost::this_thread::interruption_point();
@@ -155,11 +163,12 @@ void TCPSocket::Accept(TCPListener& listener)
   this->socket = socket;
 }
 
-void TCPSocket::HandshakeTLS(TLSSocket::HandshakeRole role)
+void TCPSocket::HandshakeTLS(TLSSocket::HandshakeRole role, bool kernelOffload,
+                             const TLSSession& resume)
 {
   try
   {
-    tls.reset(new TLSSocket(*this, role));
+    tls.reset(new TLSSocket(*this, role, resume.get(), kernelOffload));
   }
   catch (const NetworkError&)
   {
@@ -219,6 +228,116 @@ void TCPSocket::Write(const char* buffer, size_t bufferLen)
   }
 }
 
+size_t TCPSocket::TryRead(char* buffer, size_t bufferSize)
+{
+  if (tls.get())
+  {
+    size_t len = 0;
+    tls->TryRead(buffer, bufferSize, len);
+    boost::this_thread::interruption_point();
+    return len;
+  }
+  
+  ssize_t result;
+  while ((result = recv(socket, buffer, bufferSize, MSG_DONTWAIT)) < 0)
+  {
+    boost::this_thread::interruption_point();
+    if (errno != EINTR)
+    {
+      if (errno == EWOULDBLOCK || errno == EAGAIN) return 0;
+      throw NetworkSystemError(errno);
+    }
+  }
+
+  boost::this_thread::interruption_point();
+  if (!result) throw EndOfStream();
+  
+  return result;
+}
+
+size_t TCPSocket::TryWrite(const char* buffer, size_t bufferLen)
+{
+  if (tls.get())
+  {
+    size_t len = 0;
+    tls->TryWrite(buffer, bufferLen, len);
+    boost::this_thread::interruption_point();
+    return len;
+  }
+  
+  ssize_t result;
+  while ((result = send(socket, buffer, bufferLen, MSG_DONTWAIT)) < 0)
+  {
+    boost::this_thread::interruption_point();
+    if (errno != EINTR)
+    {
+      if (errno == EWOULDBLOCK || errno == EAGAIN) return 0;
+      throw NetworkSystemError(errno);
+    }
+  }
+  
+  boost::this_thread::interruption_point();
+  return result;
+}
+
+#if defined(__linux__)
+size_t TCPSocket::SendFile(int fd, off_t& offset, size_t count)
+{
+  assert(!tls.get() || IsKernelTLS());
+  
+  size_t sent = 0;
+  ssize_t result;
+  while (count - sent > 0)
+  {
+    while ((result = sendfile(socket, fd, &offset, count - sent)) < 0)
+    {
+      boost::this_thread::interruption_point();
+      if (errno != EINTR)
+      {
+        if (errno == EWOULDBLOCK || errno == EAGAIN || errno == ETIMEDOUT)
+        {
+          if (sent > 0) return sent;
+          throw TimeoutError();
+        }
+        else
+          throw NetworkSystemError(errno);
+      }
+    }
+    boost::this_thread::interruption_point();
+    if (result == 0) break;
+    sent += result;
+  }
+  
+  return sent;
+}
+#endif
+
+#if defined(__linux__)
+size_t TCPSocket::Splice(int pipeFd, size_t count)
+{
+  assert(!tls.get());
+  
+  ssize_t result;
+  while ((result = splice(socket, nullptr, pipeFd, nullptr, count, 
+                          SPLICE_F_MOVE | SPLICE_F_MORE)) < 0)
+  {
+    boost::this_thread::interruption_point();
+    if (errno != EINTR)
+    {
+      if (errno == EWOULDBLOCK || errno == EAGAIN || errno == ETIMEDOUT)
+        throw TimeoutError();
+      else
+        throw NetworkSystemError(errno);
+    }
+  }
+  
+  boost::this_thread::interruption_point();
+  if (!result) throw EndOfStream();
+  
+  return result;
+}
+#endif
+
 void TCPSocket::SetTimeout(int socket)
 {
   if (setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout.Timeval(), sizeof(timeout.Timeval())) < 0)
@@ -228,6 +347,26 @@ void TCPSocket::SetTimeout(int socket)
     throw NetworkSystemError(errno);
 }
 
+void TCPSocket::SetBlocking(bool blocking)
+{
+  int flags = fcntl(socket, F_GETFL);
+  if (flags < 0) throw NetworkSystemError(errno);
+  flags = blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK;
+  if (fcntl(socket, F_SETFL, flags) < 0) throw NetworkSystemError(errno);
+}
+
+void TCPSocket::SetSendBuffer(int size)
+{
+  if (setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) < 0)
+    throw NetworkSystemError(errno);
+}
+
+void TCPSocket::SetReceiveBuffer(int size)
+{
+  if (setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0)
+    throw NetworkSystemError(errno);
+}
+
 void TCPSocket::SetTimeout(const util::TimePair& timeout)
 {
   this->timeout = timeout;
@@ -272,20 +411,78 @@ void TCPSocket::Getline(char *buffer, size_t bufferSize, bool stripCRLF)
 void TCPSocket::Getline(std::string& buffer, bool stripCRLF)
 {
   buffer.clear();
-  buffer.reserve(defaultBufferSize);
   
-  char ch;
-  do
+  // whole lines at a time from what's already buffered, only going back
+  // to the socket once the buffer holds no complete line
+  while (true)
   {
-    ch = GetcharBuffered();
-    if (!stripCRLF || (ch != '\r' && ch != '\n'))
+    if (!getcharBufferLen)
     {
-      buffer += ch;
-      if (buffer.length() == buffer.capacity())
-        buffer.reserve((buffer.capacity() / defaultBufferSize) + 1);
+      getcharBufferLen = Read(getcharBuffer, sizeof(getcharBuffer));
+      getcharBufferPos = getcharBuffer;
     }
+    
+    const char* end = static_cast<const char*>(memchr(getcharBufferPos, '\n', getcharBufferLen));
+    size_t len = end ? end - getcharBufferPos + 1 : getcharBufferLen;
+    buffer.append(getcharBufferPos, len);
+    getcharBufferPos += len;
+    getcharBufferLen -= len;
+    if (end) break;
+  }
+  
+  if (stripCRLF)
+  {
+    buffer.erase(std::remove_if(buffer.begin(), buffer.end(), 
+        [](char ch) { return ch == '\r' || ch == '\n'; }), buffer.end());
   }
-  while (ch != '\n');
+}
+
+bool TCPSocket::BufferLine()
+{
+  if (getcharBufferLen > 0 && memchr(getcharBufferPos, '\n', getcharBufferLen)) return true;
+  
+  if (getcharBufferLen > 0 && getcharBufferPos != getcharBuffer)
+    memmove(getcharBuffer, getcharBufferPos, getcharBufferLen);
+  getcharBufferPos = getcharBuffer;
+  
+  // tls data is decrypted into the line buffer here too, so none is left
+  // waiting inside openssl where epoll can't see it
+  while (true)
+  {
+    size_t space = sizeof(getcharBuffer) - getcharBufferLen;
+    if (!space) return true;
+    
+    char* start = getcharBuffer + getcharBufferLen;
+    size_t len;
+    if (tls.get())
+    {
+      try
+      {
+        if (!tls->TryRead(start, space, len)) return false;
+      }
+      catch (const NetworkError&)
+      {
+        // left for the worker to report
+        return true;
+      }
+    }
+    else
+    {
+      ssize_t result = recv(socket, start, space, MSG_DONTWAIT);
+      if (result < 0) return errno != EWOULDBLOCK && errno != EAGAIN && errno != EINTR;
+      if (!result) return true;
+      len = result;
+    }
+    
+    getcharBufferLen += len;
+    if (memchr(start, '\n', len)) return true;
+  }
+}
+
+bool TCPSocket::LineBuffered() const
+{
+  if (getcharBufferLen > 0 && memchr(getcharBufferPos, '\n', getcharBufferLen)) return true;
+  return tls.get() && tls->Pending() > 0;
 }
 
 void TCPSocket::Close()
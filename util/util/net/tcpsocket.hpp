@@ -33,7 +33,7 @@ private:
   size_t getcharBufferLen;
   
   void Connect(const Endpoint& remoteEndpoint, 
-               const Endpoint* localEndpoint);
+               const Endpoint* localEndpoint, int bufferSize);
   
   char GetcharBuffered();
   void SetTimeout(int socket);
@@ -57,10 +57,22 @@ public:
   void Connect(const Endpoint& remoteEndpoint, const Endpoint& localEndpoint);
   /* Throws NetworkSystemError, InvalidIPAddressError */
 
+  void Connect(const Endpoint& remoteEndpoint, const Endpoint& localEndpoint,
+               int bufferSize);
+  /* Sets SO_SNDBUF / SO_RCVBUF to bufferSize before connecting so the */
+  /* window scale negotiated in the handshake can make use of it */
+  /* Throws NetworkSystemError, InvalidIPAddressError */
+
   void Accept(TCPListener& listener);
   /* Throws NetworkSystemError, InvalidIPAddressError */
   
-  void HandshakeTLS(TLSSocket::HandshakeRole role);
+  void Accept(int socket);
+  /* Takes ownership of a socket from TCPListener::AcceptSocket, closing */
+  /* it on failure */
+  /* Throws NetworkSystemError, InvalidIPAddressError */
+  
+  void HandshakeTLS(TLSSocket::HandshakeRole role, bool kernelOffload = false,
+                    const TLSSession& resume = TLSSession());
   /* Same as TLSSocket::Handshake() */
   
   size_t Read(char* buffer, size_t bufferSize);
@@ -71,6 +83,34 @@ public:
   /* (No TLS) Throws NetworkSystemError */
   /* (With TLS) Same as TLSSocket::Write() */
   
+  size_t TryRead(char* buffer, size_t bufferSize);
+  /* Reads without blocking, returns 0 if no data is available */
+  /* (No TLS) Throws NetworkSystemError, EndOfStream */
+  /* (With TLS) Same as TLSSocket::TryRead() */
+  
+  size_t TryWrite(const char* buffer, size_t bufferLen);
+  /* Writes without blocking, returns the bytes written which is 0 if */
+  /* the send buffer is full, a TLS retry must pass the same arguments */
+  /* (No TLS) Throws NetworkSystemError */
+  /* (With TLS) Same as TLSSocket::TryWrite() */
+  
+#if defined(__linux__)
+  size_t SendFile(int fd, off_t& offset, size_t count);
+  /* Sends up to count bytes from fd at offset directly from the page */
+  /* cache, advances offset and returns the bytes sent, 0 at end of file */
+  /* Returns early with a partial count if the send buffer fills */
+  /* (No TLS) Throws NetworkSystemError, TimeoutError */
+  /* (With TLS) Only supported when IsKernelTLS(), asserts otherwise */
+#endif
+  
+#if defined(__linux__)
+  size_t Splice(int pipeFd, size_t count);
+  /* Moves up to count bytes from the socket into the write end of a pipe */
+  /* without copying through userspace and returns the bytes moved */
+  /* (No TLS) Throws NetworkSystemError, TimeoutError, EndOfStream */
+  /* (With TLS) Not supported, asserts */
+#endif
+  
   void Getline(char* buffer, size_t bufferSize, bool stripCRLF = true);
   /* (No TLS) Throws NetworkSystemError, BufferSizeExceeded */
   /* (With TLS) Same as TLSSocket::Read(), BufferSizeExceeded */
@@ -79,11 +119,30 @@ public:
   /* (No TLS) Throws NetworkSystemError */
   /* (With TLS) Same as TLSSocket::Read() */
 
+  bool BufferLine();
+  /* (No TLS) Non-blocking read into the line buffer, returns true when a */
+  /* complete line is buffered or the socket has reached end of stream */
+  /* (With TLS) Always returns true */
+  /* No exceptions */
+  
+  bool LineBuffered() const;
+  /* Returns true if Getline can be satisfied without waiting on the socket */
+  /* No exceptions */
+
   void SetTimeout(const util::TimePair& timeout);
   /* Throws NetworkSystemError */
 
   const util::TimePair& Timeout() const { return timeout; }
   
+  void SetBlocking(bool blocking);
+  /* Throws NetworkSystemError */
+  
+  void SetSendBuffer(int size);
+  /* Throws NetworkSystemError */
+  
+  void SetReceiveBuffer(int size);
+  /* Throws NetworkSystemError */
+  
   void Close();
   /* No exceptions */
   
@@ -102,7 +161,10 @@ public:
   bool IsConnected() const { return socket >= 0; }
   
   bool IsTLS() const { return tls.get() != 0; }
+  bool IsKernelTLS() const { return tls.get() && tls->KernelSend(); }
+  bool TLSPending() const { return tls.get() && tls->Pending() > 0; }
   std::string TLSCipher() const;
+  TLSSession ResumableSession() const { return tls.get() ? tls->Session() : TLSSession(); }
 };
 
 } /* net namespace */
@@ -14,6 +14,8 @@ namespace util { namespace net
 std::unique_ptr<TLSClientContext> TLSContext::client;
 std::unique_ptr<TLSServerContext> TLSContext::server;
 boost::shared_array<std::mutex> TLSContext::mutexes(new std::mutex[CRYPTO_num_locks()]);
+std::atomic<unsigned long long> TLSContext::fullHandshakes(0);
+std::atomic<unsigned long long> TLSContext::resumedHandshakes(0);
 
 namespace
 {
@@ -211,8 +213,14 @@ SSL_CTX* TLSClientContext::Get()
 }
 
 TLSServerContext::TLSServerContext(const std::string& certificate,
-                                   const std::string& ciphers) :
-  TLSContext(certificate, ciphers)
+                                   const std::string& ciphers,
+                                   long sessionCacheSize,
+                                   long sessionTimeout,
+                                   long ticketRotation) :
+  TLSContext(certificate, ciphers),
+  sessionCacheSize(sessionCacheSize),
+  sessionTimeout(sessionTimeout),
+  ticketRotation(ticketRotation)
 {
 }
 
@@ -230,10 +238,14 @@ void TLSServerContext::CreateContext()
 }
 
 void TLSServerContext::Initialise(const std::string& certificate,
-                                  const std::string& ciphers)
+                                  const std::string& ciphers,
+                                  long sessionCacheSize,
+                                  long sessionTimeout,
+                                  long ticketRotation)
 {
   assert(!server.get());
-  server.reset(new TLSServerContext(certificate, ciphers));
+  server.reset(new TLSServerContext(certificate, ciphers, sessionCacheSize, 
+                                    sessionTimeout, ticketRotation));
   try
   {
     server->TLSContext::Initialise();
@@ -245,6 +257,105 @@ void TLSServerContext::Initialise(const std::string& certificate,
   }
 }
 
+void TLSServerContext::InitialiseSessionCaching()
+{
+  // data connections resume the control connection's session, shared by
+  // every session and thread through the one context
+  static const unsigned char sessionIdContext[] = "ebftpd";
+  if (SSL_CTX_set_session_id_context(context, sessionIdContext, 
+                                     sizeof(sessionIdContext) - 1) != 1)
+    throw TLSProtocolError();
+  
+  SSL_CTX_set_timeout(context, sessionTimeout);
+  if (sessionCacheSize > 0)
+  {
+    SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(context, sessionCacheSize);
+  }
+  else
+  {
+    SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_OFF);
+  }
+  
+  if (ticketRotation > 0)
+  {
+    if (!RotateTicketKeys()) throw TLSProtocolError();
+    SSL_CTX_set_tlsext_ticket_key_cb(context, TicketKeyCallback);
+  }
+  else
+  {
+    SSL_CTX_set_options(context, SSL_OP_NO_TICKET);
+  }
+}
+
+bool TLSServerContext::RotateTicketKeys()
+{
+  time_t now = std::time(nullptr);
+  if (ticketKeys[0].created > 0 && now - ticketKeys[0].created < ticketRotation) 
+    return true;
+  
+  TicketKey key;
+  if (RAND_bytes(key.name, sizeof(key.name)) != 1 ||
+      RAND_bytes(key.hmacKey, sizeof(key.hmacKey)) != 1 ||
+      RAND_bytes(key.aesKey, sizeof(key.aesKey)) != 1)
+    return false;
+  
+  key.created = now;
+  ticketKeys[1] = ticketKeys[0];
+  ticketKeys[0] = key;
+  return true;
+}
+
+int TLSServerContext::TicketKeys(unsigned char* name, unsigned char* iv, 
+                                 EVP_CIPHER_CTX* cipherCtx, HMAC_CTX* hmacCtx, 
+                                 int encrypt)
+{
+  std::lock_guard<std::mutex> lock(ticketMutex);
+  if (!RotateTicketKeys()) return -1;
+  
+  if (encrypt)
+  {
+    const TicketKey& key = ticketKeys[0];
+    if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1) return -1;
+    std::memcpy(name, key.name, sizeof(key.name));
+    if (EVP_EncryptInit_ex(cipherCtx, EVP_aes_256_cbc(), nullptr, key.aesKey, iv) != 1 ||
+        HMAC_Init_ex(hmacCtx, key.hmacKey, sizeof(key.hmacKey), EVP_sha256(), nullptr) != 1)
+      return -1;
+    return 1;
+  }
+  
+  for (int i = 0; i < 2; ++i)
+  {
+    const TicketKey& key = ticketKeys[i];
+    if (key.created == 0 || std::memcmp(name, key.name, sizeof(key.name)) != 0) continue;
+    
+    if (HMAC_Init_ex(hmacCtx, key.hmacKey, sizeof(key.hmacKey), EVP_sha256(), nullptr) != 1 ||
+        EVP_DecryptInit_ex(cipherCtx, EVP_aes_256_cbc(), nullptr, key.aesKey, iv) != 1)
+      return -1;
+    
+    // 2 has openssl issue a new ticket under the current key
+    return i == 0 ? 1 : 2;
+  }
+  
+  // unknown or expired key, full handshake
+  return 0;
+}
+
+int TLSServerContext::TicketKeyCallback(SSL* ssl, unsigned char* name, unsigned char* iv, 
+                                        EVP_CIPHER_CTX* cipherCtx, HMAC_CTX* hmacCtx, 
+                                        int encrypt)
+{
+  (void) ssl;
+  if (!server.get()) return -1;
+  return server->TicketKeys(name, iv, cipherCtx, hmacCtx, encrypt);
+}
+
+long TLSServerContext::CachedSessions()
+{
+  if (!server.get()) return 0;
+  return SSL_CTX_sess_number(server->context);
+}
+
 void TLSServerContext::InitialiseDHKeyExchange()
 {
   // if this fails, ciphers requiring DH key exchange
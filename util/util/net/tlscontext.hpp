@@ -1,6 +1,8 @@
 #ifndef __UTIL_NET_TLS_HPP
 #define __UTIL_NET_TLS_HPP
 
+#include <atomic>
+#include <ctime>
 #include <memory>
 #include <string>
 #include <openssl/ssl.h>
@@ -8,6 +10,8 @@
 #include <openssl/rand.h>
 #include <openssl/crypto.h>
 #include <openssl/rsa.h>
+#include <openssl/hmac.h>
+#include <openssl/evp.h>
 #include <mutex>
 #include <boost/shared_array.hpp>
 
@@ -33,6 +37,8 @@ protected:
   static std::unique_ptr<TLSClientContext> client;
   static boost::shared_array<std::mutex> mutexes;
   
+  static std::atomic<unsigned long long> fullHandshakes;
+  static std::atomic<unsigned long long> resumedHandshakes;
   
   virtual ~TLSContext();
   
@@ -49,6 +55,15 @@ protected:
   
   static unsigned long ThreadIdCallback();
   static void MutexLockCallback(int mode, int n, const char * file, int line);
+  
+public:
+  static void CountHandshake(bool resumed)
+  {
+    ++(resumed ? resumedHandshakes : fullHandshakes);
+  }
+  
+  static unsigned long long FullHandshakes() { return fullHandshakes; }
+  static unsigned long long ResumedHandshakes() { return resumedHandshakes; }
 };
 
 class TLSClientContext : public TLSContext
@@ -70,12 +85,40 @@ public:
 
 class TLSServerContext : public TLSContext
 {
+  // session tickets are encrypted with the current key, tickets from the
+  // previous key are still accepted but replaced on use
+  struct TicketKey
+  {
+    unsigned char name[16];
+    unsigned char hmacKey[32];
+    unsigned char aesKey[32];
+    time_t created;
+    
+    TicketKey() : created(0) { }
+  };
+  
+  long sessionCacheSize;
+  long sessionTimeout;
+  long ticketRotation;
+  
+  std::mutex ticketMutex;
+  TicketKey ticketKeys[2];
+  
   TLSServerContext(const std::string& certificate,
-                   const std::string& ciphers);
+                   const std::string& ciphers,
+                   long sessionCacheSize,
+                   long sessionTimeout,
+                   long ticketRotation);
 
   void CreateContext();
-  void InitialiseSessionCaching() { }
+  void InitialiseSessionCaching();
   void InitialiseDHKeyExchange();
+  
+  bool RotateTicketKeys();
+  int TicketKeys(unsigned char* name, unsigned char* iv, EVP_CIPHER_CTX* cipherCtx,
+                 HMAC_CTX* hmacCtx, int encrypt);
+  static int TicketKeyCallback(SSL* ssl, unsigned char* name, unsigned char* iv, 
+                               EVP_CIPHER_CTX* cipherCtx, HMAC_CTX* hmacCtx, int encrypt);
   void DerivedInitialise()
   {
     InitialiseSessionCaching();
@@ -84,10 +127,18 @@ class TLSServerContext : public TLSContext
   
 public:
   static void Initialise(const std::string& certificate,
-                         const std::string& ciphers = "");
+                         const std::string& ciphers = "",
+                         long sessionCacheSize = 20480,
+                         long sessionTimeout = 300,
+                         long ticketRotation = 3600);
+  /* sessionCacheSize 0 disables the session cache and ticketRotation 0 */
+  /* disables session tickets, both in seconds */
   /* Throws TLSError, TLSProtocolError */
 
   static SSL_CTX* Get();
+  
+  static long CachedSessions();
+  /* No exceptions */
 };
 
 } /* net namespace */
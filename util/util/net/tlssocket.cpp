@@ -1,3 +1,4 @@
+#include <fcntl.h>
 #include <boost/thread/thread.hpp>
 #include "util/net/tlssocket.hpp"
 #include "util/net/tcpsocket.hpp"
@@ -19,10 +20,11 @@ TLSSocket::TLSSocket() :
 {
 }
 
-TLSSocket::TLSSocket(TCPSocket& socket, HandshakeRole role, TLSSocket* id) :
+TLSSocket::TLSSocket(TCPSocket& socket, HandshakeRole role, SSL_SESSION* resume,
+                     bool kernelOffload) :
   session(nullptr)
 {
-  Handshake(socket, role, id);
+  Handshake(socket, role, resume, kernelOffload);
 }
 
 void TLSSocket::EvaluateResult(int result)
@@ -62,7 +64,8 @@ void TLSSocket::EvaluateResult(int result)
   }
 }
 
-void TLSSocket::Handshake(TCPSocket& socket, HandshakeRole role, TLSSocket* id)
+void TLSSocket::Handshake(TCPSocket& socket, HandshakeRole role, SSL_SESSION* resume,
+                          bool kernelOffload)
 {
 
   SSL_CTX* ctx = role == Client ?
@@ -76,7 +79,16 @@ void TLSSocket::Handshake(TCPSocket& socket, HandshakeRole role, TLSSocket* id)
   
   if (SSL_set_fd(session, socket.Socket()) != 1) throw TLSProtocolError();
   
-  if (id) SSL_copy_session_id(session, id->session);
+  // a session that can't be resumed falls back to a full handshake
+  if (resume && role == Client) SSL_set_session(session, resume);
+  
+#if defined(SSL_OP_ENABLE_KTLS)
+  // openssl installs the keys into the kernel during the handshake if the
+  // tls module is loaded and the cipher is supported
+  if (kernelOffload) SSL_set_options(session, SSL_OP_ENABLE_KTLS);
+#else
+  (void) kernelOffload;
+#endif
   
   if (role == Client) SSL_set_connect_state(session);
   else SSL_set_accept_state(session);
@@ -90,6 +102,8 @@ void TLSSocket::Handshake(TCPSocket& socket, HandshakeRole role, TLSSocket* id)
     if (result == 1) break;
     else EvaluateResult(result);
   }
+  
+  TLSContext::CountHandshake(SSL_session_reused(session));
 }
 
 size_t TLSSocket::Read(char* buffer, size_t bufferSize)
@@ -103,6 +117,31 @@ size_t TLSSocket::Read(char* buffer, size_t bufferSize)
   }
 }
 
+bool TLSSocket::TryRead(char* buffer, size_t bufferSize, size_t& len)
+{
+  // data connections are already non-blocking, otherwise the fd is only
+  // made non-blocking for this read as every other use expects it to block
+  int fd = SSL_get_fd(session);
+  int flags = fcntl(fd, F_GETFL);
+  if (flags < 0) throw TLSSystemError(errno);
+  if (!(flags & O_NONBLOCK) && fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    throw TLSSystemError(errno);
+  
+  int result = SSL_read(session, buffer, bufferSize);
+  int error = result > 0 ? SSL_ERROR_NONE : SSL_get_error(session, result);
+  if (!(flags & O_NONBLOCK)) (void) fcntl(fd, F_SETFL, flags);
+  
+  if (result > 0)
+  {
+    len = result;
+    return true;
+  }
+  
+  if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) return false;
+  EvaluateResult(result);
+  return false;
+}
+
 void TLSSocket::Write(const char* buffer, size_t bufferLen)
 {
   size_t written = 0;
@@ -115,6 +154,29 @@ void TLSSocket::Write(const char* buffer, size_t bufferLen)
   }
 }
 
+bool TLSSocket::TryWrite(const char* buffer, size_t bufferLen, size_t& len)
+{
+  int fd = SSL_get_fd(session);
+  int flags = fcntl(fd, F_GETFL);
+  if (flags < 0) throw TLSSystemError(errno);
+  if (!(flags & O_NONBLOCK) && fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    throw TLSSystemError(errno);
+  
+  int result = SSL_write(session, buffer, bufferLen);
+  int error = result > 0 ? SSL_ERROR_NONE : SSL_get_error(session, result);
+  if (!(flags & O_NONBLOCK)) (void) fcntl(fd, F_SETFL, flags);
+  
+  if (result > 0)
+  {
+    len = result;
+    return true;
+  }
+  
+  if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) return false;
+  EvaluateResult(result);
+  return false;
+}
+
 void TLSSocket::Close()
 {
   if (session)
@@ -125,6 +187,30 @@ void TLSSocket::Close()
   }
 }
 
+int TLSSocket::Pending() const
+{
+  if (!session) return 0;
+  return SSL_pending(session);
+}
+
+bool TLSSocket::KernelSend() const
+{
+#if defined(SSL_OP_ENABLE_KTLS)
+  if (!session) return false;
+  return BIO_get_ktls_send(SSL_get_wbio(session)) > 0;
+#else
+  return false;
+#endif
+}
+
+TLSSession TLSSocket::Session() const
+{
+  if (!session) return TLSSession();
+  SSL_SESSION* sess = SSL_get1_session(session);
+  if (!sess) return TLSSession();
+  return TLSSession(sess, SSL_SESSION_free);
+}
+
 std::string TLSSocket::Cipher() const
 {
   if (!session) return "NONE";
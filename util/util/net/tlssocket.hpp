@@ -2,6 +2,7 @@
 #define __UTIL_NET_TLSSOCKET_HPP
 
 #include <cstdint>
+#include <memory>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 #include <boost/noncopyable.hpp>
@@ -11,6 +12,9 @@ namespace util { namespace net
 
 class TCPSocket;
 
+// a client side session kept to resume a later connection with
+typedef std::shared_ptr<SSL_SESSION> TLSSession;
+
 class TLSSocket : private boost::noncopyable
 {
   SSL* session;
@@ -29,21 +33,43 @@ public:
   TLSSocket();
   /* No exceptions */
   
-  TLSSocket(TCPSocket& socket, HandshakeRole role, TLSSocket* id = 0);
+  TLSSocket(TCPSocket& socket, HandshakeRole role, SSL_SESSION* resume = nullptr,
+            bool kernelOffload = false);
   /* Throws TLSError, TLSProtocolError, TLSSystemError, EndOfStream */
   
-  void Handshake(TCPSocket& socket, HandshakeRole role, TLSSocket* id = 0);
+  void Handshake(TCPSocket& socket, HandshakeRole role, SSL_SESSION* resume = nullptr,
+                 bool kernelOffload = false);
   /* Throws TLSError, TLSProtocolError, TLSSystemError, EndOfStream */
+  /* resume is offered to the server in the client role, ignored otherwise */
+  /* kernelOffload requests ktls, silently falls back to openssl when */
+  /* unsupported by openssl, the kernel or the negotiated cipher */
   
   size_t Read(char* buffer, size_t bufferSize);
   /* Throws TLSError, TLSProtocolError, TLSSystemError, EndOfStream */
+  bool TryRead(char* buffer, size_t bufferSize, size_t& len);
+  /* Returns false rather than waiting when no data can be decrypted yet */
+  /* Throws TLSError, TLSProtocolError, TLSSystemError, EndOfStream */
   void Write(const char* buffer, size_t bufferLen);
   /* Throws TLSError, TLSProtocolError, TLSSystemError, EndOfStream */
+  bool TryWrite(const char* buffer, size_t bufferLen, size_t& len);
+  /* Returns false rather than waiting when the record can't be sent yet, */
+  /* the retry must pass the same buffer and length */
+  /* Throws TLSError, TLSProtocolError, TLSSystemError, EndOfStream */
   
   void Close();
   /* No exceptions */
   
+  int Pending() const;
+  /* No exceptions */
+  
+  bool KernelSend() const;
+  /* True if writes on the underlying fd are encrypted by the kernel */
+  /* No exceptions */
+  
   std::string Cipher() const;
+  
+  TLSSession Session() const;
+  /* Null if there's no session, No exceptions */
 };
 
 } /* net namespace */